@@ -0,0 +1,143 @@
+#include "Benchmarks.h"
+
+//External includes
+#include "SDL.h"
+
+//Standard includes
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+//Project includes
+#include "Renderer.h"
+#include "Timer.h"
+
+//Every operator new of the Bench target goes through these, whoever calls it, the array forms by default call these too
+//Only operator new gets counted: malloc calls that never go through it, like the ones inside SDL, don't show up
+namespace
+{
+	std::atomic<uint64_t> g_NrAllocations{};
+
+	void* Allocate(size_t size)
+	{
+		++g_NrAllocations;
+		if (void* pData{ std::malloc(size > 0 ? size : 1) })
+			return pData;
+		throw std::bad_alloc{};
+	}
+
+	void* AllocateAligned(size_t size, std::align_val_t alignment)
+	{
+		++g_NrAllocations;
+		const size_t alignmentSize{ static_cast<size_t>(alignment) };
+#ifdef _MSC_VER
+		void* pData{ _aligned_malloc(size > 0 ? size : 1, alignmentSize) };
+#else
+		//aligned_alloc wants a whole number of alignments
+		void* pData{ std::aligned_alloc(alignmentSize, (size + alignmentSize) / alignmentSize * alignmentSize) };
+#endif
+		if (pData)
+			return pData;
+		throw std::bad_alloc{};
+	}
+
+	void FreeAligned(void* pData)
+	{
+#ifdef _MSC_VER
+		_aligned_free(pData);
+#else
+		std::free(pData);
+#endif
+	}
+}
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void operator delete(void* pData) noexcept { std::free(pData); }
+void operator delete(void* pData, size_t) noexcept { std::free(pData); }
+void operator delete(void* pData, std::align_val_t) noexcept { FreeAligned(pData); }
+void operator delete(void* pData, size_t, std::align_val_t) noexcept { FreeAligned(pData); }
+
+namespace dae
+{
+	bool Benchmarks::RunAllocations()
+	{
+		constexpr int nrWarmUpFrames{ 3 };
+		constexpr int nrCountedFrames{ 10 };
+		constexpr int nrShadingModes{ 4 };
+
+		//A direct operator new call can't be left out by the compiler, it has to show up or the counts mean nothing
+		const uint64_t nrProbeAllocations{ g_NrAllocations.load() };
+		::operator delete(::operator new(1));
+		if (g_NrAllocations.load() == nrProbeAllocations)
+		{
+			std::cout << "FAILED: the counting operator new isn't the one in use" << std::endl;
+			return false;
+		}
+
+		SDL_Window* pWindow{ SDL_CreateWindow("Bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 640, 480, SDL_WINDOW_HIDDEN) };
+		if (!pWindow)
+		{
+			std::cout << "FAILED: no window to render to" << std::endl;
+			return false;
+		}
+
+		Timer* pTimer{ new Timer{} };
+		Renderer* pRenderer{ new Renderer{ pWindow } };
+		pTimer->Start();
+
+		//The renderer starts on the best path the CPU has, cycling goes through the others and back
+		//Every switch prints the configuration the counts under it belong to
+		std::cout << "Shading: depth buffer, deferred, with the vertex cache, on the best rasterizer path" << std::endl;
+		const int nrInstructionSets{ static_cast<int>(RasterKernels::InstructionSet::AVX2) + 1 };
+		bool isAllocationFree{ true };
+		for (int instructionSet{ 0 }; instructionSet < nrInstructionSets; ++instructionSet)
+		{
+			for (int vertexCache{ 0 }; vertexCache < 2; ++vertexCache)
+			{
+				for (int deferral{ 0 }; deferral < 2; ++deferral)
+				{
+					for (int shadingMode{ 0 }; shadingMode < nrShadingModes; ++shadingMode)
+					{
+						//Growing the frame arena and the other buffers to what this configuration needs is allowed to call operator new
+						for (int frame{ 0 }; frame < nrWarmUpFrames; ++frame)
+						{
+							pTimer->Update();
+							pRenderer->Update(pTimer);
+							pRenderer->Render();
+						}
+
+						const uint64_t nrAllocationsBefore{ g_NrAllocations.load() };
+						for (int frame{ 0 }; frame < nrCountedFrames; ++frame)
+						{
+							pTimer->Update();
+							pRenderer->Update(pTimer);
+							pRenderer->Render();
+						}
+						const uint64_t nrAllocations{ g_NrAllocations.load() - nrAllocationsBefore };
+
+						std::cout << "  " << nrAllocations << " operator new calls in " << nrCountedFrames << " frames after warm-up" << std::endl;
+						isAllocationFree &= nrAllocations == 0;
+
+						pRenderer->CycleShadingMode();
+					}
+					pRenderer->ToggleDeferredShading();
+				}
+				pRenderer->ToggleVertexCache();
+			}
+			pRenderer->CycleInstructionSet();
+		}
+
+		delete pRenderer;
+		delete pTimer;
+		SDL_DestroyWindow(pWindow);
+
+		if (!isAllocationFree)
+		{
+			std::cout << "FAILED: steady state rendering called operator new" << std::endl;
+		}
+		return isAllocationFree;
+	}
+}
@@ -0,0 +1,69 @@
+//External includes
+#include "SDL.h"
+#undef main
+
+//Standard includes
+#include <cstring>
+#include <iostream>
+
+//Project includes
+#include "Benchmarks.h"
+
+using namespace dae;
+
+namespace
+{
+	struct Benchmark
+	{
+		const char* name;
+		bool(*pRun)();
+	};
+
+	const Benchmark g_Benchmarks[]
+	{
+		{ "stride", &Benchmarks::RunStride },
+		{ "allocations", &Benchmarks::RunAllocations },
+		{ "threads", &Benchmarks::RunThreadScaling },
+		{ "obj", &Benchmarks::RunObjLoad },
+		{ "sampling", &Benchmarks::RunSampling },
+		{ "rotation", &Benchmarks::RunRotation },
+		{ "isa", &Benchmarks::RunInstructionSets }
+	};
+}
+
+//Bench [name...], runs the named benchmarks or all of them, the exit code is 1 when a check failed
+//Run from the source folder, like Rasterizer, the benchmarks read Resources
+int main(int argc, char* args[])
+{
+	SDL_Init(SDL_INIT_VIDEO);
+
+	bool hasFailed{ false };
+	bool hasRun{ false };
+	for (const Benchmark& benchmark : g_Benchmarks)
+	{
+		bool isPicked{ argc <= 1 };
+		for (int arg{ 1 }; arg < argc; ++arg)
+		{
+			isPicked |= std::strcmp(args[arg], benchmark.name) == 0;
+		}
+		if (!isPicked)
+			continue;
+
+		std::cout << "--- " << benchmark.name << std::endl;
+		hasFailed |= !benchmark.pRun();
+		hasRun = true;
+	}
+
+	if (!hasRun)
+	{
+		std::cout << "No benchmark with that name, there are:";
+		for (const Benchmark& benchmark : g_Benchmarks)
+		{
+			std::cout << ' ' << benchmark.name;
+		}
+		std::cout << std::endl;
+	}
+
+	SDL_Quit();
+	return hasFailed || !hasRun ? 1 : 0;
+}
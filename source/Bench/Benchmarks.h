@@ -0,0 +1,43 @@
+#pragma once
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+
+namespace dae
+{
+	//Benchmarks behind the performance claims of the renderer, built as their own Bench target
+	//Every benchmark prints its own table and returns false when one of the checks it makes fails
+	namespace Benchmarks
+	{
+		//Old column order and unpadded rows against row order and cache line aligned rows, with cache miss counts on Linux
+		bool RunStride();
+		//Counts the operator new calls of steady state frames in every renderer configuration, fails unless there are none
+		bool RunAllocations();
+		//Vertex stage of a synthetic 1M vertex mesh on thread pools of 1 up to every hardware thread, fails when the output changes
+		bool RunThreadScaling();
+		//std::ifstream parser against the memory mapped Utils::ParseOBJ on a scaled up vehicle.obj, fails when the thread pool changes the mesh
+		bool RunObjLoad();
+		//SDL_GetRGB per sample against the packed texels of Texture, single and batched, fails when their colors differ
+		bool RunSampling();
+		//Linear against Tiled texels over uvs rotated from 0 to 90 degrees, point and trilinear, fails when the layouts sample other colors
+		bool RunRotation();
+		//Renders one fixed frame on every rasterizer path, forward and deferred, fails unless the back, depth and visibility buffers match Scalar byte for byte
+		bool RunInstructionSets();
+
+		//Best wall clock time of nrRuns calls of function in milliseconds, the best run has the least of the other processes in it
+		template<typename Function>
+		double MeasureBestMs(int nrRuns, const Function& function)
+		{
+			double bestMs{ 1e30 };
+			for (int run{ 0 }; run < nrRuns; ++run)
+			{
+				const auto start{ std::chrono::steady_clock::now() };
+				function();
+				const auto end{ std::chrono::steady_clock::now() };
+				bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+			return bestMs;
+		}
+	}
+}
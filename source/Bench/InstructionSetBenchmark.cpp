@@ -0,0 +1,140 @@
+#include "Benchmarks.h"
+
+//External includes
+#include "SDL.h"
+
+//Standard includes
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Renderer.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int g_Width{ 640 };
+		constexpr int g_Height{ 480 };
+
+		//The first frame of a shading mode, what every other path has to match byte for byte
+		struct ReferenceFrame
+		{
+			std::vector<uint32_t> backBuffer{};
+			std::vector<float> depthBuffer{};
+			//Empty until a frame of the mode deferred its shading, 0 where the depth buffer wasn't written
+			std::vector<uint32_t> visibilityBuffer{};
+		};
+
+		//Visible part of every row, the padding behind it is never drawn to
+		template<typename Pixel>
+		std::vector<Pixel> CopyRows(const Pixel* pPixels, int stride)
+		{
+			std::vector<Pixel> rows(static_cast<size_t>(g_Width) * g_Height);
+			for (int y{ 0 }; y < g_Height; ++y)
+			{
+				std::memcpy(rows.data() + static_cast<size_t>(y) * g_Width, pPixels + static_cast<size_t>(y) * stride, g_Width * sizeof(Pixel));
+			}
+			return rows;
+		}
+
+		//Triangle ids only mean something where a triangle won the depth test
+		std::vector<uint32_t> CopyVisibility(const Renderer& renderer)
+		{
+			std::vector<uint32_t> visibility{ CopyRows(renderer.GetVisibilityBufferPixels(), renderer.GetBufferStride()) };
+			const std::vector<float> depth{ CopyRows(renderer.GetDepthBufferPixels(), renderer.GetBufferStride()) };
+			for (size_t pixel{ 0 }; pixel < visibility.size(); ++pixel)
+			{
+				visibility[pixel] = depth[pixel] == FLT_MAX ? 0 : visibility[pixel];
+			}
+			return visibility;
+		}
+
+		template<typename Pixel>
+		bool IsSame(const std::vector<Pixel>& reference, const std::vector<Pixel>& frame)
+		{
+			return std::memcmp(reference.data(), frame.data(), reference.size() * sizeof(Pixel)) == 0;
+		}
+	}
+
+	bool Benchmarks::RunInstructionSets()
+	{
+		constexpr int nrShadingModes{ 4 };
+
+		SDL_Window* pWindow{ SDL_CreateWindow("Bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, g_Width, g_Height, SDL_WINDOW_HIDDEN) };
+		if (!pWindow)
+		{
+			std::cout << "FAILED: no window to render to" << std::endl;
+			return false;
+		}
+
+		//The camera never gets updated, so every configuration draws the same frame
+		Renderer* pRenderer{ new Renderer{ pWindow } };
+		while (pRenderer->GetInstructionSet() != RasterKernels::InstructionSet::Scalar)
+		{
+			pRenderer->CycleInstructionSet();
+		}
+
+		//Scalar comes first, so its frames are the references the SIMD paths get held to
+		//Forward and deferred shading have to agree as well, and so do both vertex stages
+		std::cout << "Shading: depth buffer, deferred, with the vertex cache" << std::endl;
+		ReferenceFrame references[nrShadingModes]{};
+		bool isIdentical{ true };
+		do
+		{
+			for (int vertexCache{ 0 }; vertexCache < 2; ++vertexCache)
+			{
+				for (int deferral{ 0 }; deferral < 2; ++deferral)
+				{
+					for (int shadingMode{ 0 }; shadingMode < nrShadingModes; ++shadingMode)
+					{
+						pRenderer->Render();
+
+						ReferenceFrame& reference{ references[shadingMode] };
+						const std::vector<uint32_t> backBuffer{ CopyRows(pRenderer->GetBackBufferPixels(), pRenderer->GetBufferStride()) };
+						const std::vector<float> depthBuffer{ CopyRows(pRenderer->GetDepthBufferPixels(), pRenderer->GetBufferStride()) };
+						if (reference.backBuffer.empty())
+						{
+							reference.backBuffer = backBuffer;
+							reference.depthBuffer = depthBuffer;
+						}
+
+						std::string differences{};
+						differences += IsSame(reference.backBuffer, backBuffer) ? "" : " back buffer";
+						differences += IsSame(reference.depthBuffer, depthBuffer) ? "" : " depth buffer";
+						if (pRenderer->GetVisibilityBufferPixels())
+						{
+							const std::vector<uint32_t> visibilityBuffer{ CopyVisibility(*pRenderer) };
+							if (reference.visibilityBuffer.empty())
+							{
+								reference.visibilityBuffer = visibilityBuffer;
+							}
+							differences += IsSame(reference.visibilityBuffer, visibilityBuffer) ? "" : " visibility buffer";
+						}
+
+						std::cout << "  " << (differences.empty() ? "identical to Scalar" : "differs from Scalar in the" + differences) << std::endl;
+						isIdentical &= differences.empty();
+
+						pRenderer->CycleShadingMode();
+					}
+					pRenderer->ToggleDeferredShading();
+				}
+				pRenderer->ToggleVertexCache();
+			}
+			pRenderer->CycleInstructionSet();
+		} while (pRenderer->GetInstructionSet() != RasterKernels::InstructionSet::Scalar);
+
+		delete pRenderer;
+		SDL_DestroyWindow(pWindow);
+
+		if (!isIdentical)
+		{
+			std::cout << "FAILED: the rasterizer paths don't draw the same frame" << std::endl;
+		}
+		return isIdentical;
+	}
+}
@@ -0,0 +1,259 @@
+#include "Benchmarks.h"
+
+//Standard includes
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "ThreadPool.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace
+	{
+		//The std::ifstream parser Utils::ParseOBJ replaced, kept as it was to measure against
+		bool ParseOBJIostream(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
+		{
+			std::ifstream file(filename);
+			if (!file)
+				return false;
+
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> normals{};
+			std::vector<Vector2> UVs{};
+
+			vertices.clear();
+			indices.clear();
+
+			std::string sCommand;
+			while (!file.eof())
+			{
+				file >> sCommand;
+				if (sCommand == "#")
+				{
+				}
+				else if (sCommand == "v")
+				{
+					float x, y, z;
+					file >> x >> y >> z;
+					positions.emplace_back(x, y, z);
+				}
+				else if (sCommand == "vt")
+				{
+					float u, v;
+					file >> u >> v;
+					UVs.emplace_back(u, 1 - v);
+				}
+				else if (sCommand == "vn")
+				{
+					float x, y, z;
+					file >> x >> y >> z;
+					normals.emplace_back(x, y, z);
+				}
+				else if (sCommand == "f")
+				{
+					Vertex vertex{};
+					size_t iPosition, iTexCoord, iNormal;
+
+					uint32_t tempIndices[3];
+					for (size_t iFace = 0; iFace < 3; iFace++)
+					{
+						file >> iPosition;
+						vertex.position = positions[iPosition - 1];
+
+						if ('/' == file.peek())
+						{
+							file.ignore();
+
+							if ('/' != file.peek())
+							{
+								file >> iTexCoord;
+								vertex.uv = UVs[iTexCoord - 1];
+							}
+
+							if ('/' == file.peek())
+							{
+								file.ignore();
+								file >> iNormal;
+								vertex.normal = normals[iNormal - 1];
+							}
+						}
+
+						vertices.push_back(vertex);
+						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
+					}
+
+					indices.push_back(tempIndices[0]);
+					if (flipAxisAndWinding)
+					{
+						indices.push_back(tempIndices[2]);
+						indices.push_back(tempIndices[1]);
+					}
+					else
+					{
+						indices.push_back(tempIndices[1]);
+						indices.push_back(tempIndices[2]);
+					}
+				}
+				file.ignore(1000, '\n');
+			}
+
+			for (uint32_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t index0 = indices[i];
+				uint32_t index1 = indices[size_t(i) + 1];
+				uint32_t index2 = indices[size_t(i) + 2];
+
+				const Vector3& p0 = vertices[index0].position;
+				const Vector3& p1 = vertices[index1].position;
+				const Vector3& p2 = vertices[index2].position;
+				const Vector2& uv0 = vertices[index0].uv;
+				const Vector2& uv1 = vertices[index1].uv;
+				const Vector2& uv2 = vertices[index2].uv;
+
+				const Vector3 edge0 = p1 - p0;
+				const Vector3 edge1 = p2 - p0;
+				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
+				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
+				float r = 1.f / Vector2::Cross(diffX, diffY);
+
+				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
+				vertices[index0].tangent += tangent;
+				vertices[index1].tangent += tangent;
+				vertices[index2].tangent += tangent;
+			}
+
+			for (auto& v : vertices)
+			{
+				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+
+				if (flipAxisAndWinding)
+				{
+					v.position.z *= -1.f;
+					v.normal.z *= -1.f;
+					v.tangent.z *= -1.f;
+				}
+			}
+
+			return true;
+		}
+
+		//nrCopies copies of source one after the other, the face indices of every copy moved past the attributes of the ones before it
+		bool WriteScaledOBJ(const std::string& sourceFilename, const std::string& filename, int nrCopies)
+		{
+			std::ifstream source(sourceFilename);
+			if (!source)
+				return false;
+
+			std::vector<std::string> lines{};
+			size_t nrPositions{}, nrUVs{}, nrNormals{};
+			for (std::string line; std::getline(source, line);)
+			{
+				nrPositions += line.rfind("v ", 0) == 0;
+				nrUVs += line.rfind("vt ", 0) == 0;
+				nrNormals += line.rfind("vn ", 0) == 0;
+				lines.push_back(std::move(line));
+			}
+
+			std::ofstream file(filename, std::ios::binary);
+			if (!file)
+				return false;
+
+			for (int copy{ 0 }; copy < nrCopies; ++copy)
+			{
+				const size_t offsets[3]{ copy * nrPositions, copy * nrUVs, copy * nrNormals };
+				for (const std::string& line : lines)
+				{
+					if (line.rfind("f ", 0) != 0)
+					{
+						file << line << '\n';
+						continue;
+					}
+
+					//Corners are position/uv/normal, every one of them 1 based and present in vehicle.obj
+					std::istringstream corners{ line.substr(2) };
+					file << 'f';
+					for (std::string corner; corners >> corner;)
+					{
+						file << ' ';
+						size_t attribute{ 0 };
+						size_t start{ 0 };
+						while (start <= corner.size())
+						{
+							const size_t end{ std::min(corner.find('/', start), corner.size()) };
+							if (attribute > 0)
+								file << '/';
+							if (end > start)
+								file << std::stoull(corner.substr(start, end - start)) + offsets[std::min(attribute, size_t{ 2 })];
+							start = end + 1;
+							++attribute;
+						}
+					}
+					file << '\n';
+				}
+			}
+			return static_cast<bool>(file);
+		}
+	}
+
+	bool Benchmarks::RunObjLoad()
+	{
+		constexpr int nrCopies{ 32 };
+		constexpr int nrRuns{ 3 };
+		constexpr double targetSpeedup{ 10.0 };
+
+		const std::string filename{ (std::filesystem::temp_directory_path() / "dae_bench_vehicle_scaled.obj").string() };
+		if (!WriteScaledOBJ("Resources/vehicle.obj", filename, nrCopies))
+		{
+			std::cout << "FAILED: couldn't write " << filename << " from Resources/vehicle.obj" << std::endl;
+			return false;
+		}
+		const double megabytes{ static_cast<double>(std::filesystem::file_size(filename)) / (1024.0 * 1024.0) };
+		std::cout << "Resources/vehicle.obj x " << nrCopies << ", " << std::fixed << std::setprecision(1) << megabytes << " MB" << std::endl;
+
+		ThreadPool threadPool{};
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+		std::vector<Vertex> pooledVertices{};
+		std::vector<uint32_t> pooledIndices{};
+
+		//The iostream parser takes long enough that one run already has little noise
+		const double iostreamMs{ MeasureBestMs(1, [&]() { ParseOBJIostream(filename, vertices, indices); }) };
+		const double serialMs{ MeasureBestMs(nrRuns, [&]() { Utils::ParseOBJ(filename, vertices, indices); }) };
+		const double pooledMs{ MeasureBestMs(nrRuns, [&]() { Utils::ParseOBJ(filename, pooledVertices, pooledIndices, true, &threadPool); }) };
+		std::filesystem::remove(filename);
+
+		const auto printRow{ [&](const std::string& name, double ms)
+			{
+				std::cout << "  " << std::left << std::setw(36) << name << std::right << std::setw(9) << std::setprecision(1) << ms << " ms "
+					<< std::setw(8) << megabytes / (ms / 1000.0) << " MB/s " << std::setw(6) << iostreamMs / ms << "x" << std::endl;
+			} };
+		printRow("std::ifstream parser", iostreamMs);
+		printRow("memory mapped, one thread", serialMs);
+		printRow("memory mapped, " + std::to_string(threadPool.GetNrThreads()) + " threads", pooledMs);
+
+		const double speedup{ iostreamMs / std::min(serialMs, pooledMs) };
+		if (speedup < targetSpeedup)
+		{
+			std::cout << "Below the " << targetSpeedup << "x the parser was asked for, " << std::setprecision(2) << speedup << "x" << std::endl;
+		}
+
+		//The thread pool only splits the work, the mesh has to come out the same
+		const bool isIdentical{ vertices.size() == pooledVertices.size() && indices == pooledIndices
+			&& std::memcmp(vertices.data(), pooledVertices.data(), vertices.size() * sizeof(Vertex)) == 0 };
+		if (!isIdentical)
+		{
+			std::cout << "FAILED: parsing on the thread pool gave another mesh" << std::endl;
+		}
+		return isIdentical;
+	}
+}
@@ -0,0 +1,149 @@
+#include "Benchmarks.h"
+
+//Standard includes
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Texture.h"
+#include "Vector2.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Colors of every sample of one screen, summed so they can't get optimized away and can be compared between the layouts
+		struct RotatedScreen
+		{
+			double ms{};
+			float sum{};
+		};
+
+		//A screenSize x screenSize screen at one level 0 texel per pixel, its uvs rotated by angle degrees around the center of the texture
+		//Batched samples every plane 8 pixels at a time like the pixel shaders, otherwise plane 0 one pixel at a time
+		RotatedScreen SampleRotated(const Texture& texture, int screenSize, int angle, TextureFilter filter, bool isBatched, RasterKernels::InstructionSet instructionSet, int nrRuns)
+		{
+			const float radians{ angle * 3.14159265f / 180.f };
+			const Vector2 uvDdx{ std::cos(radians) / texture.GetWidth(), std::sin(radians) / texture.GetHeight() };
+			const Vector2 uvDdy{ -std::sin(radians) / texture.GetWidth(), std::cos(radians) / texture.GetHeight() };
+			const Vector2 topLeft{ Vector2{ 0.5f, 0.5f } - uvDdx * (screenSize * 0.5f) - uvDdy * (screenSize * 0.5f) };
+
+			float mipLevels[TextureKernels::BatchSize]{};
+			std::fill(std::begin(mipLevels), std::end(mipLevels), texture.ComputeMipLevel(uvDdx, uvDdy));
+
+			RotatedScreen screen{};
+			screen.ms = Benchmarks::MeasureBestMs(nrRuns, [&]()
+				{
+					screen.sum = 0.f;
+					TextureKernels::SampleBatch batch{};
+					for (int y{ 0 }; y < screenSize; ++y)
+					{
+						const Vector2 rowStart{ topLeft + uvDdy * static_cast<float>(y) };
+						if (!isBatched)
+						{
+							for (int x{ 0 }; x < screenSize; ++x)
+							{
+								const ColorRGB color{ texture.Sample(rowStart + uvDdx * static_cast<float>(x), uvDdx, uvDdy, filter) };
+								screen.sum += color.r + color.g + color.b;
+							}
+							continue;
+						}
+
+						for (int x{ 0 }; x < screenSize; x += TextureKernels::BatchSize)
+						{
+							for (int lane{ 0 }; lane < TextureKernels::BatchSize; ++lane)
+							{
+								const Vector2 uv{ rowStart + uvDdx * static_cast<float>(x + lane) };
+								batch.u[lane] = uv.x;
+								batch.v[lane] = uv.y;
+							}
+							texture.Sample(batch, mipLevels, filter, instructionSet);
+							for (int plane{ 0 }; plane < texture.GetNrPlanes(); ++plane)
+							{
+								for (int lane{ 0 }; lane < TextureKernels::BatchSize; ++lane)
+									screen.sum += batch.r[plane][lane] + batch.g[plane][lane] + batch.b[plane][lane];
+							}
+						}
+					}
+				});
+			return screen;
+		}
+	}
+
+	bool Benchmarks::RunRotation()
+	{
+		constexpr int screenSize{ 1024 };
+		constexpr int nrRuns{ 3 };
+		constexpr int angles[]{ 0, 15, 30, 45, 60, 75, 90 };
+
+		//The material the renderer draws with and the single texture it used before
+		const std::vector<std::vector<std::string>> textures
+		{
+			{ "Resources/vehicle_diffuse.png", "Resources/vehicle_normal.png", "Resources/vehicle_gloss.png", "Resources/vehicle_specular.png" },
+			{ "Resources/tuktuk.png" }
+		};
+		const RasterKernels::InstructionSet instructionSet{ RasterKernels::DetectInstructionSet() };
+
+		bool isIdentical{ true };
+		for (const std::vector<std::string>& paths : textures)
+		{
+			Texture* pLinear{ Texture::LoadFromFiles(paths, TextureLayout::Linear) };
+			Texture* pTiled{ Texture::LoadFromFiles(paths, TextureLayout::Tiled) };
+			if (!pLinear || !pTiled)
+			{
+				std::cout << "FAILED: " << paths.front() << " didn't load" << std::endl;
+				delete pLinear;
+				delete pTiled;
+				return false;
+			}
+
+			std::cout << paths.front() << ", " << pTiled->GetNrPlanes() << " x " << pTiled->GetWidth() << 'x' << pTiled->GetHeight()
+				<< ", " << screenSize << 'x' << screenSize << " screen at one texel per pixel, ns/sample at" << std::endl << std::setw(32) << ' ';
+			for (int angle : angles)
+			{
+				std::cout << std::setw(6) << angle << ' ';
+			}
+			std::cout << " worst/best" << std::endl;
+
+			for (bool isBatched : { false, true })
+			{
+				for (TextureFilter filter : { TextureFilter::Point, TextureFilter::Trilinear })
+				{
+					for (const Texture* pTexture : { pLinear, pTiled })
+					{
+						const std::string name{ std::string{ pTexture == pLinear ? "linear " : "tiled " } + (filter == TextureFilter::Point ? "point, " : "trilinear, ")
+							+ (isBatched ? std::string{ "batched " } + RasterKernels::GetName(instructionSet) : std::string{ "Sample(uv)" }) };
+						std::cout << "  " << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(1);
+
+						double bestMs{ 1e30 };
+						double worstMs{ 0.0 };
+						for (int angle : angles)
+						{
+							const RotatedScreen screen{ SampleRotated(*pTexture, screenSize, angle, filter, isBatched, instructionSet, nrRuns) };
+							bestMs = std::min(bestMs, screen.ms);
+							worstMs = std::max(worstMs, screen.ms);
+							std::cout << std::setw(6) << screen.ms * 1e6 / (screenSize * screenSize) << ' ';
+
+							//Only the order of the texels differs, so the tiled screen has to come out exactly like the linear one
+							if (pTexture == pTiled)
+								isIdentical &= screen.sum == SampleRotated(*pLinear, screenSize, angle, filter, isBatched, instructionSet, 1).sum;
+						}
+						std::cout << std::setw(9) << std::setprecision(2) << worstMs / bestMs << 'x' << std::endl;
+					}
+				}
+			}
+
+			delete pLinear;
+			delete pTiled;
+		}
+
+		if (!isIdentical)
+		{
+			std::cout << "FAILED: the tiled layout samples other colors than the linear one" << std::endl;
+		}
+		return isIdentical;
+	}
+}
@@ -0,0 +1,139 @@
+#include "Benchmarks.h"
+
+//External includes
+#include "SDL.h"
+#include "SDL_image.h"
+
+//Standard includes
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Texture.h"
+#include "Vector2.h"
+
+namespace dae
+{
+	namespace
+	{
+		//What Texture::Sample did before the texels got converted at load: decode through the surface's pixel format for every sample
+		ColorRGB SampleSurface(const SDL_Surface* pSurface, const Vector2& uv)
+		{
+			Uint8 r;
+			Uint8 g;
+			Uint8 b;
+
+			const size_t x{ static_cast<size_t>(uv.x * pSurface->w) };
+			const size_t y{ static_cast<size_t>(uv.y * pSurface->h) };
+
+			const Uint32 pixel{ static_cast<const uint32_t*>(pSurface->pixels)[x + y * pSurface->w] };
+
+			SDL_GetRGB(pixel, pSurface->format, &r, &g, &b);
+
+			const constexpr float clamp{ 1 / 255.f };
+
+			return { r * clamp,g * clamp,b * clamp };
+		}
+
+		float Sum(const ColorRGB& color)
+		{
+			return color.r + color.g + color.b;
+		}
+	}
+
+	bool Benchmarks::RunSampling()
+	{
+		constexpr int gridSize{ 1024 };
+		constexpr int nrRuns{ 5 };
+		const char* const path{ "Resources/tuktuk.png" };
+
+		SDL_Surface* pSurface{ IMG_Load(path) };
+		Texture* pTexture{ Texture::LoadFromFile(path) };
+		if (!pSurface || !pTexture || pSurface->format->BytesPerPixel != 4)
+		{
+			std::cout << "FAILED: " << path << " didn't load as a 32 bit image" << std::endl;
+			SDL_FreeSurface(pSurface);
+			delete pTexture;
+			return false;
+		}
+
+		//One sample per pixel of a 1024x1024 screen the texture is stretched over, in the order the rasterizer visits them
+		std::vector<Vector2> uvs(static_cast<size_t>(gridSize) * gridSize);
+		for (size_t uvIndex{ 0 }; uvIndex < uvs.size(); ++uvIndex)
+		{
+			uvs[uvIndex] = { (uvIndex % gridSize + 0.5f) / gridSize, (uvIndex / gridSize + 0.5f) / gridSize };
+		}
+
+		//The sums keep the samples from getting optimized away and have to come out the same on every path
+		float surfaceSum{};
+		const double surfaceMs{ MeasureBestMs(nrRuns, [&]()
+			{
+				surfaceSum = 0.f;
+				for (const Vector2& uv : uvs)
+					surfaceSum += Sum(SampleSurface(pSurface, uv));
+			}) };
+
+		float textureSum{};
+		const double textureMs{ MeasureBestMs(nrRuns, [&]()
+			{
+				textureSum = 0.f;
+				for (const Vector2& uv : uvs)
+					textureSum += Sum(pTexture->Sample(uv));
+			}) };
+
+		const auto printRow{ [&](const char* name, double ms)
+			{
+				std::cout << "  " << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+					<< std::setw(7) << ms * 1e6 / uvs.size() << " ns/sample " << std::setw(6) << surfaceMs / ms << "x" << std::endl;
+			} };
+		std::cout << path << ", " << pTexture->GetWidth() << 'x' << pTexture->GetHeight() << ", " << uvs.size() << " point samples" << std::endl;
+		printRow("SDL_GetRGB per sample", surfaceMs);
+		printRow("packed RGBA8, Sample(uv)", textureMs);
+		bool isIdentical{ textureSum == surfaceSum };
+
+		//The batched samples the pixel shaders take, 8 uvs at a time
+		const float mipLevels[TextureKernels::BatchSize]{};
+		for (int instructionSet{ 0 }; instructionSet <= static_cast<int>(RasterKernels::DetectInstructionSet()); ++instructionSet)
+		{
+			TextureKernels::SampleBatch batch{};
+			float batchSum{};
+			const double batchMs{ MeasureBestMs(nrRuns, [&]()
+				{
+					batchSum = 0.f;
+					for (size_t first{ 0 }; first < uvs.size(); first += TextureKernels::BatchSize)
+					{
+						for (int lane{ 0 }; lane < TextureKernels::BatchSize; ++lane)
+						{
+							batch.u[lane] = uvs[first + lane].x;
+							batch.v[lane] = uvs[first + lane].y;
+						}
+						pTexture->Sample(batch, mipLevels, TextureFilter::Point, static_cast<RasterKernels::InstructionSet>(instructionSet), 1);
+						for (int lane{ 0 }; lane < TextureKernels::BatchSize; ++lane)
+							batchSum += batch.r[0][lane] + batch.g[0][lane] + batch.b[0][lane];
+					}
+				}) };
+
+			const std::string name{ std::string{ "packed RGBA8, batched " } + RasterKernels::GetName(static_cast<RasterKernels::InstructionSet>(instructionSet)) };
+			printRow(name.c_str(), batchMs);
+			isIdentical &= batchSum == surfaceSum;
+		}
+
+		SDL_FreeSurface(pSurface);
+		delete pTexture;
+
+		if (!isIdentical)
+		{
+			std::cout << "FAILED: the converted texels don't give the colors SDL_GetRGB does" << std::endl;
+		}
+		//The packed texels are only worth converting at load if the single sample gets faster from it
+		const bool isFaster{ textureMs < surfaceMs };
+		if (!isFaster)
+		{
+			std::cout << "FAILED: Sample(uv) isn't faster than SDL_GetRGB per sample" << std::endl;
+		}
+		return isIdentical && isFaster;
+	}
+}
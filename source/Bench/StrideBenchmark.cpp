@@ -0,0 +1,288 @@
+#include "Benchmarks.h"
+
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		//Hardware cache miss counters of the calling thread
+		//Only Linux has them, elsewhere or when perf_event_paranoid doesn't allow them IsValid is false and only the times mean something
+		class CacheMissCounters final
+		{
+		public:
+			static constexpr int NrCounters{ 3 };
+			static constexpr const char* Names[NrCounters]{ "L1D misses", "LLC misses", "dTLB misses" };
+
+			CacheMissCounters()
+			{
+#ifdef __linux__
+				const uint64_t configs[NrCounters]
+				{
+					PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+					PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+					PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+				};
+				for (int counter{ 0 }; counter < NrCounters; ++counter)
+				{
+					perf_event_attr attributes{};
+					attributes.type = PERF_TYPE_HW_CACHE;
+					attributes.size = sizeof(perf_event_attr);
+					attributes.config = configs[counter];
+					attributes.disabled = 1;
+					attributes.exclude_kernel = 1;
+					attributes.exclude_hv = 1;
+					m_Files[counter] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+				}
+#endif
+			}
+
+			~CacheMissCounters()
+			{
+#ifdef __linux__
+				for (int file : m_Files)
+				{
+					if (file >= 0)
+						close(file);
+				}
+#endif
+			}
+
+			CacheMissCounters(const CacheMissCounters&) = delete;
+			CacheMissCounters(CacheMissCounters&&) noexcept = delete;
+			CacheMissCounters& operator=(const CacheMissCounters&) = delete;
+			CacheMissCounters& operator=(CacheMissCounters&&) noexcept = delete;
+
+			bool IsValid(int counter) const { return m_Files[counter] >= 0; }
+
+			void Start()
+			{
+#ifdef __linux__
+				for (int file : m_Files)
+				{
+					if (file >= 0)
+					{
+						ioctl(file, PERF_EVENT_IOC_RESET, 0);
+						ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+					}
+				}
+#endif
+			}
+
+			//Counts since Start, 0 for the counters that aren't valid
+			void Stop(uint64_t(&counts)[NrCounters])
+			{
+				for (int counter{ 0 }; counter < NrCounters; ++counter)
+				{
+					counts[counter] = 0;
+#ifdef __linux__
+					if (m_Files[counter] >= 0)
+					{
+						ioctl(m_Files[counter], PERF_EVENT_IOC_DISABLE, 0);
+						if (read(m_Files[counter], &counts[counter], sizeof(uint64_t)) != sizeof(uint64_t))
+							counts[counter] = 0;
+					}
+#endif
+				}
+			}
+
+		private:
+			int m_Files[NrCounters]{ -1, -1, -1 };
+		};
+
+		//Bounding box of a triangle with the depth plane through it, what the old RenderMeshTriangle walked pixel by pixel
+		struct DepthBox
+		{
+			int minX, minY, maxX, maxY;
+			float depth, depthDx, depthDy;
+			uint32_t color;
+		};
+
+		struct StrideTarget
+		{
+			float* pDepth;
+			uint32_t* pColor;
+			int stride;
+		};
+
+		//Depth test and write of one pixel, the same work in every order so only the memory access pattern differs
+		inline void ShadePixel(const StrideTarget& target, const DepthBox& box, int px, int py)
+		{
+			const float depth{ box.depth + px * box.depthDx + py * box.depthDy };
+			const int pixelIdx{ px + py * target.stride };
+			if (depth < target.pDepth[pixelIdx])
+			{
+				target.pDepth[pixelIdx] = depth;
+				target.pColor[pixelIdx] = box.color;
+			}
+		}
+
+		//The baseline order, px outer and py inner, every step jumps a whole row
+		void DrawColumnOrder(const StrideTarget& target, const std::vector<DepthBox>& boxes)
+		{
+			for (const DepthBox& box : boxes)
+			{
+				for (int px{ box.minX }; px <= box.maxX; ++px)
+				{
+					for (int py{ box.minY }; py <= box.maxY; ++py)
+					{
+						ShadePixel(target, box, px, py);
+					}
+				}
+			}
+		}
+
+		void DrawRowOrder(const StrideTarget& target, const std::vector<DepthBox>& boxes)
+		{
+			for (const DepthBox& box : boxes)
+			{
+				for (int py{ box.minY }; py <= box.maxY; ++py)
+				{
+					for (int px{ box.minX }; px <= box.maxX; ++px)
+					{
+						ShadePixel(target, box, px, py);
+					}
+				}
+			}
+		}
+
+		std::vector<DepthBox> CreateBoxes(int width, int height)
+		{
+			//Same seed every run, so every variant draws the same scene
+			std::mt19937 random{ 1 };
+			std::uniform_int_distribution<int> sizeDistribution{ 8, 160 };
+			std::uniform_real_distribution<float> depthDistribution{ 0.f, 1.f };
+			std::uniform_real_distribution<float> slopeDistribution{ -1e-4f, 1e-4f };
+
+			std::vector<DepthBox> boxes(1000);
+			for (DepthBox& box : boxes)
+			{
+				const int boxWidth{ std::min(sizeDistribution(random), width) };
+				const int boxHeight{ std::min(sizeDistribution(random), height) };
+				box.minX = std::uniform_int_distribution<int>{ 0, width - boxWidth }(random);
+				box.minY = std::uniform_int_distribution<int>{ 0, height - boxHeight }(random);
+				box.maxX = box.minX + boxWidth - 1;
+				box.maxY = box.minY + boxHeight - 1;
+				box.depth = depthDistribution(random);
+				box.depthDx = slopeDistribution(random);
+				box.depthDy = slopeDistribution(random);
+				box.color = static_cast<uint32_t>(random());
+			}
+			return boxes;
+		}
+	}
+
+	bool Benchmarks::RunStride()
+	{
+		//Same as Renderer::m_BufferAlignment
+		constexpr int bufferAlignment{ 64 };
+		constexpr int pixelsPerCacheLine{ bufferAlignment / static_cast<int>(sizeof(float)) };
+		constexpr int nrRuns{ 5 };
+
+		CacheMissCounters counters{};
+		if (!counters.IsValid(0))
+		{
+			std::cout << "No hardware cache counters here (Linux with a CPU PMU and perf_event_paranoid <= 2), printing times only" << std::endl;
+		}
+
+		bool isIdentical{ true };
+		const int resolutions[][2]{ { 640, 480 }, { 1366, 768 }, { 1920, 1080 } };
+		for (const auto& resolution : resolutions)
+		{
+			const int width{ resolution[0] };
+			const int height{ resolution[1] };
+			const std::vector<DepthBox> boxes{ CreateBoxes(width, height) };
+
+			//Unpadded rows in plain vectors, how the baseline stored the depth and SDL surface pixels
+			std::vector<float> depth(static_cast<size_t>(width) * height);
+			std::vector<uint32_t> color(static_cast<size_t>(width) * height);
+
+			//Rows padded to whole cache lines from a cache line aligned start, how the renderer stores them now
+			const int paddedStride{ (width + pixelsPerCacheLine - 1) / pixelsPerCacheLine * pixelsPerCacheLine };
+			const size_t paddedSize{ static_cast<size_t>(paddedStride) * height };
+			float* pPaddedDepth{ static_cast<float*>(::operator new[](paddedSize * sizeof(float), std::align_val_t{ bufferAlignment })) };
+			uint32_t* pPaddedColor{ static_cast<uint32_t*>(::operator new[](paddedSize * sizeof(uint32_t), std::align_val_t{ bufferAlignment })) };
+
+			struct Variant
+			{
+				const char* name;
+				StrideTarget target;
+				void(*pDraw)(const StrideTarget& target, const std::vector<DepthBox>& boxes);
+			};
+			const Variant variants[]
+			{
+				{ "column order, unpadded", { depth.data(), color.data(), width }, &DrawColumnOrder },
+				{ "row order, unpadded", { depth.data(), color.data(), width }, &DrawRowOrder },
+				{ "row order, aligned stride", { pPaddedDepth, pPaddedColor, paddedStride }, &DrawRowOrder }
+			};
+
+			std::cout << width << 'x' << height << ", stride " << width << " -> " << paddedStride << std::endl;
+			double firstChecksum{};
+			for (const Variant& variant : variants)
+			{
+				double bestMs{ 1e30 };
+				uint64_t bestCounts[CacheMissCounters::NrCounters]{};
+				for (int run{ 0 }; run < nrRuns; ++run)
+				{
+					std::fill_n(variant.target.pDepth, static_cast<size_t>(variant.target.stride) * height, FLT_MAX);
+
+					uint64_t counts[CacheMissCounters::NrCounters]{};
+					counters.Start();
+					const double ms{ MeasureBestMs(1, [&]() { variant.pDraw(variant.target, boxes); }) };
+					counters.Stop(counts);
+					if (ms < bestMs)
+					{
+						bestMs = ms;
+						std::copy(std::begin(counts), std::end(counts), std::begin(bestCounts));
+					}
+				}
+
+				//Every order does the same depth tests in the same order per pixel, so they have to end up with the same buffer
+				double checksum{};
+				for (int py{ 0 }; py < height; ++py)
+				{
+					for (int px{ 0 }; px < width; ++px)
+					{
+						checksum += variant.target.pDepth[px + py * variant.target.stride];
+					}
+				}
+				if (&variant == &variants[0])
+					firstChecksum = checksum;
+				isIdentical &= checksum == firstChecksum;
+
+				std::cout << "  " << std::left << std::setw(28) << variant.name << std::right << std::fixed << std::setprecision(2) << std::setw(8) << bestMs << " ms";
+				for (int counter{ 0 }; counter < CacheMissCounters::NrCounters; ++counter)
+				{
+					if (counters.IsValid(counter))
+						std::cout << "  " << CacheMissCounters::Names[counter] << ' ' << std::setw(10) << bestCounts[counter];
+				}
+				std::cout << std::endl;
+			}
+
+			::operator delete[](pPaddedDepth, std::align_val_t{ bufferAlignment });
+			::operator delete[](pPaddedColor, std::align_val_t{ bufferAlignment });
+		}
+
+		if (!isIdentical)
+		{
+			std::cout << "FAILED: the traversal orders gave different depth buffers" << std::endl;
+		}
+		return isIdentical;
+	}
+}
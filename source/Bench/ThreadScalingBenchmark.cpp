@@ -0,0 +1,129 @@
+#include "Benchmarks.h"
+
+//Standard includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//Project includes
+#include "Matrix.h"
+#include "ThreadPool.h"
+#include "VertexKernels.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Outputs of one whole vertex stage, sized for every vertex
+		struct VertexStageOutput
+		{
+			std::vector<Vector2> screenPositions;
+			std::vector<float> depths;
+			std::vector<float> invW;
+			std::vector<uint16_t> clipCodes;
+
+			explicit VertexStageOutput(size_t nrVertices) :
+				screenPositions(nrVertices),
+				depths(nrVertices),
+				invW(nrVertices),
+				clipCodes(nrVertices)
+			{
+			}
+
+			bool operator==(const VertexStageOutput& other) const
+			{
+				const size_t nrVertices{ depths.size() };
+				return std::memcmp(screenPositions.data(), other.screenPositions.data(), nrVertices * sizeof(Vector2)) == 0
+					&& std::memcmp(depths.data(), other.depths.data(), nrVertices * sizeof(float)) == 0
+					&& std::memcmp(invW.data(), other.invW.data(), nrVertices * sizeof(float)) == 0
+					&& std::memcmp(clipCodes.data(), other.clipCodes.data(), nrVertices * sizeof(uint16_t)) == 0;
+			}
+		};
+	}
+
+	bool Benchmarks::RunThreadScaling()
+	{
+		//Same as Renderer::m_VertexChunkSize
+		constexpr size_t vertexChunkSize{ 4096 };
+		constexpr int gridSize{ 1000 };
+		constexpr size_t nrVertices{ static_cast<size_t>(gridSize) * gridSize };
+		constexpr int nrRuns{ 10 };
+
+		//Synthetic 1M vertex mesh, a sloped grid in front of the camera that reaches past the frustum so the clip codes get work too
+		VertexStreams streams{};
+		streams.positionX.resize(nrVertices);
+		streams.positionY.resize(nrVertices);
+		streams.positionZ.resize(nrVertices);
+		for (size_t vertexIndex{ 0 }; vertexIndex < nrVertices; ++vertexIndex)
+		{
+			const float x{ static_cast<float>(vertexIndex % gridSize) / gridSize };
+			const float y{ static_cast<float>(vertexIndex / gridSize) / gridSize };
+			streams.positionX[vertexIndex] = (x - 0.5f) * 60.f;
+			streams.positionY[vertexIndex] = (y - 0.5f) * 40.f;
+			streams.positionZ[vertexIndex] = 10.f * x * y;
+		}
+
+		const Matrix worldViewProjection{ Matrix::CreateTranslation(0.f, 0.f, 30.f) * Matrix::CreatePerspectiveFovLH(0.57f, 640.f / 480.f, 0.1f, 100.f) };
+		const uint32_t nrChunks{ static_cast<uint32_t>((nrVertices + vertexChunkSize - 1) / vertexChunkSize) };
+		const uint32_t maxNrThreads{ std::max(std::thread::hardware_concurrency(), 1u) };
+
+		//Every kernel and thread count has to give the output of the scalar kernel on one thread
+		VertexStageOutput reference{ nrVertices };
+		bool isDeterministic{ true };
+
+		//The scalar kernel and the one the renderer picks, the same one on CPUs without SIMD kernels
+		std::vector<RasterKernels::InstructionSet> instructionSets{ RasterKernels::InstructionSet::Scalar };
+		if (RasterKernels::DetectInstructionSet() != RasterKernels::InstructionSet::Scalar)
+			instructionSets.push_back(RasterKernels::DetectInstructionSet());
+
+		for (RasterKernels::InstructionSet instructionSet : instructionSets)
+		{
+			const VertexKernels::TransformKernel pTransformKernel{ VertexKernels::GetTransformKernel(instructionSet) };
+			std::cout << RasterKernels::GetName(instructionSet) << ", " << nrVertices << " vertices in chunks of " << vertexChunkSize << std::endl;
+
+			double oneThreadMs{};
+			for (uint32_t nrThreads{ 1 }; nrThreads <= maxNrThreads; ++nrThreads)
+			{
+				ThreadPool threadPool{ nrThreads };
+				VertexStageOutput output{ nrVertices };
+				const VertexKernels::TransformTarget target{ output.screenPositions.data(), output.depths.data(), output.invW.data(), output.clipCodes.data(), 640.f, 480.f };
+
+				//The vertex stage of Renderer::TransformMeshPositions
+				const double ms{ MeasureBestMs(nrRuns, [&]()
+					{
+						threadPool.ParallelFor(nrChunks, [&](uint32_t chunkIndex)
+							{
+								const size_t first{ chunkIndex * vertexChunkSize };
+								pTransformKernel(worldViewProjection, streams, first, std::min(vertexChunkSize, nrVertices - first), target);
+							});
+					}) };
+
+				if (nrThreads == 1)
+				{
+					oneThreadMs = ms;
+					if (instructionSet == RasterKernels::InstructionSet::Scalar)
+						reference = output;
+				}
+				const bool isIdentical{ output == reference };
+				isDeterministic &= isIdentical;
+
+				std::cout << "  " << std::setw(3) << nrThreads << " threads " << std::fixed << std::setprecision(2) << std::setw(8) << ms << " ms "
+					<< std::setw(6) << oneThreadMs / ms << "x" << (isIdentical ? "" : "  DIFFERENT OUTPUT") << std::endl;
+			}
+		}
+
+		if (maxNrThreads == 1)
+		{
+			std::cout << "Only one hardware thread here, nothing to scale over" << std::endl;
+		}
+		if (!isDeterministic)
+		{
+			std::cout << "FAILED: the output depends on the kernel or the number of threads" << std::endl;
+		}
+		return isDeterministic;
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "Math.h"
+#include "FrameArena.h"
 #include "vector"
 
 namespace dae
@@ -30,13 +31,101 @@ namespace dae
 		TriangleStrip
 	};
 
+	//Which facing gets dropped before rasterization, front faces have a positive signed area in screen space
+	enum class CullMode
+	{
+		None,
+		Back,
+		Front
+	};
+
+	//Structure of arrays copy of the vertex positions, so passes that only need positions don't drag the rest of Vertex through the cache
+	struct VertexStreams
+	{
+		std::vector<float> positionX{};
+		std::vector<float> positionY{};
+		std::vector<float> positionZ{};
+	};
+
 	struct Mesh
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
+		CullMode cullMode{ CullMode::Back };
+
+		//Built from vertices by Utils::BuildVertexStreams
+		VertexStreams streams{};
 
-		std::vector<Vertex_Out> vertices_out{};
+		//Rebuilt every frame in the renderer's frame arena
+		FrameVector<Vertex_Out> vertices_out{};
 		Matrix worldMatrix{};
 	};
+
+	//Triangles removed by the cull stage during one frame, per reason
+	struct CullStats
+	{
+		uint32_t outsideFrustum{};
+		uint32_t facing{};
+		uint32_t zeroArea{};
+		uint32_t noSample{};
+		uint32_t offScreen{};
+	};
+
+	//Post-transform vertex cache lookups of one mesh during one frame
+	struct VertexCacheStats
+	{
+		uint32_t nrLookups{};
+		uint32_t nrHits{};
+	};
+
+	//Value that changes linearly over the screen: stepX * x + stepY * y + offset
+	struct ScreenPlane
+	{
+		float stepX{};
+		float stepY{};
+		float offset{};
+
+		float At(float x, float y) const { return stepX * x + stepY * y + offset; }
+	};
+
+	//Everything the rasterizer needs from a triangle, calculated once before visiting any pixel
+	struct TriangleSetup
+	{
+		uint32_t vertexIndices[3]{};
+		//Index in the setups of the whole frame, what the visibility buffer holds for every pixel the triangle ends up owning
+		uint32_t id{};
+
+		//Edge function i is the edge opposite of vertex i: E(x,y) = edgeStepX * x + edgeStepY * y + edgeOffset
+		//Inside the triangle all three are >= 0, and E / area is the barycentric weight of vertex i
+		float edgeStepX[3]{};
+		float edgeStepY[3]{};
+		float edgeOffset[3]{};
+
+		float invArea{};
+		float invDepth[3]{};
+
+		//1/w and uv/w are linear in screen space where uv itself isn't, dividing them gives the perspective correct uv
+		ScreenPlane invW{};
+		ScreenPlane uOverW{};
+		ScreenPlane vOverW{};
+
+		//Closest depth anywhere on the triangle, used for Hi-Z rejection
+		float minDepth{};
+
+		//Screen space bounding box, end is exclusive
+		Int2 boundTopLeft{};
+		Int2 boundBotRight{};
+	};
+
+	//Vertex attributes over w of one triangle, for the shaders that interpolate more than uv
+	//Only built when the shading mode asks for them, kept apart so the rasterizer doesn't drag them through the cache
+	struct AttributePlanes
+	{
+		ScreenPlane colorOverW[3]{};
+		//World space, not normalized, interpolation shortens them anyway so the shaders normalize per pixel
+		ScreenPlane normalOverW[3]{};
+		ScreenPlane tangentOverW[3]{};
+		ScreenPlane viewDirectionOverW[3]{};
+	};
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+FrameArena::FrameArena(size_t initialSize)
+{
+	AddBlock(initialSize);
+}
+
+FrameArena::~FrameArena()
+{
+	FreeBlocks();
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	size_t start{ (m_Offset + alignment - 1) & ~(alignment - 1) };
+	if (start + size > m_Blocks.back().size)
+	{
+		//Doesn't fit anymore, the block after is at least twice as big so growing frames only need a few
+		AddBlock(std::max(size + alignment, m_Blocks.back().size * 2));
+		start = 0;
+	}
+
+	m_Offset = start + size;
+	return m_Blocks.back().pData + start;
+}
+
+void FrameArena::Reset()
+{
+	if (m_Blocks.size() > 1)
+	{
+		const size_t capacity{ GetCapacity() };
+		FreeBlocks();
+		AddBlock(capacity);
+	}
+	m_Offset = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+	size_t capacity{ 0 };
+	for (const Block& block : m_Blocks)
+	{
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+void FrameArena::AddBlock(size_t size)
+{
+	Block block{};
+	block.pData = static_cast<std::byte*>(::operator new[](size, std::align_val_t{ m_BlockAlignment }));
+	block.size = size;
+
+	m_Blocks.push_back(block);
+	m_Offset = 0;
+	++m_NrHeapAllocations;
+}
+
+void FrameArena::FreeBlocks()
+{
+	for (const Block& block : m_Blocks)
+	{
+		::operator delete[](block.pData, std::align_val_t{ m_BlockAlignment });
+	}
+	m_Blocks.clear();
+}
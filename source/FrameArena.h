@@ -0,0 +1,100 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	//Linear allocator for everything that only lives during one frame, freeing happens all at once in Reset
+	//Only meant to be used from one thread at a time
+	class FrameArena final
+	{
+	public:
+		FrameArena(size_t initialSize = size_t{ 1 } << 20);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		void* Allocate(size_t size, size_t alignment);
+
+		//Invalidates everything allocated so far
+		//When the last frame needed more than one block they get merged into one big enough for it, so a steady state never hits the heap
+		void Reset();
+
+		//Number of blocks ever requested from the heap, stops going up once the frames stop growing
+		uint32_t GetNrHeapAllocations() const { return m_NrHeapAllocations; }
+		size_t GetCapacity() const;
+
+	private:
+		static constexpr size_t m_BlockAlignment{ 64 };
+
+		struct Block
+		{
+			std::byte* pData{};
+			size_t size{};
+		};
+
+		std::vector<Block> m_Blocks{};
+		size_t m_Offset{};
+		uint32_t m_NrHeapAllocations{};
+
+		void AddBlock(size_t size);
+		void FreeBlocks();
+	};
+
+	//Lets standard containers live in a FrameArena, without an arena it falls back to the heap
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		using value_type = T;
+		//Containers that get a new arena vector assigned have to take its allocator along, their old memory is gone after a Reset
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		ArenaAllocator() = default;
+		ArenaAllocator(FrameArena& arena) : m_pArena{ &arena } {}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : m_pArena{ other.GetArena() } {}
+
+		T* allocate(size_t count)
+		{
+			if (!m_pArena)
+			{
+				return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{ alignof(T) }));
+			}
+			return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+		}
+
+		//Arena memory only goes away in FrameArena::Reset
+		void deallocate(T* p, size_t)
+		{
+			if (!m_pArena)
+			{
+				::operator delete(p, std::align_val_t{ alignof(T) });
+			}
+		}
+
+		FrameArena* GetArena() const { return m_pArena; }
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return m_pArena == other.GetArena(); }
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return m_pArena != other.GetArena(); }
+
+	private:
+		FrameArena* m_pArena{ nullptr };
+	};
+
+	//Has to be rebuilt after every FrameArena::Reset, the old contents are gone by then
+	template<typename T>
+	using FrameVector = std::vector<T, ArenaAllocator<T>>;
+}
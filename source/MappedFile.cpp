@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+#ifdef _WIN32
+
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		const HANDLE fileHandle{ CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		m_FileHandle = fileHandle;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(fileHandle, &size))
+		{
+			return;
+		}
+
+		m_Size = static_cast<size_t>(size.QuadPart);
+		if (m_Size == 0)
+		{
+			//Windows refuses to map an empty file
+			m_IsOpen = true;
+			return;
+		}
+
+		m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_MappingHandle)
+		{
+			return;
+		}
+
+		m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		m_IsOpen = m_pData != nullptr;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+		{
+			UnmapViewOfFile(m_pData);
+		}
+		if (m_MappingHandle)
+		{
+			CloseHandle(m_MappingHandle);
+		}
+		if (m_FileHandle)
+		{
+			CloseHandle(m_FileHandle);
+		}
+	}
+
+#else
+
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		m_FileDescriptor = open(filename.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0)
+		{
+			return;
+		}
+
+		struct stat status {};
+		if (fstat(m_FileDescriptor, &status) != 0)
+		{
+			return;
+		}
+
+		m_Size = static_cast<size_t>(status.st_size);
+		if (m_Size == 0)
+		{
+			m_IsOpen = true;
+			return;
+		}
+
+		void* pData{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+		if (pData == MAP_FAILED)
+		{
+			return;
+		}
+
+		//Everything gets read front to back exactly once
+		madvise(pData, m_Size, MADV_SEQUENTIAL);
+		m_pData = static_cast<const char*>(pData);
+		m_IsOpen = true;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+		{
+			munmap(const_cast<char*>(m_pData), m_Size);
+		}
+		if (m_FileDescriptor >= 0)
+		{
+			close(m_FileDescriptor);
+		}
+	}
+
+#endif
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <cmath>
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 
 namespace dae
 {
@@ -58,6 +60,36 @@ namespace dae
 		return v;
 	}
 
+	//log2 of x > 0 from its bits: the exponent field is the integer part, a polynomial in the mantissa m in [1, 2) does the rest
+	//Least squares fit of log2(m) = (m - 1) * p(m), off by less than 3e-5
+	inline float FastLog2(float x)
+	{
+		const uint32_t bits{ std::bit_cast<uint32_t>(x) };
+		const float exponent{ static_cast<float>(static_cast<int>(bits >> 23) - 127) };
+		const float m{ std::bit_cast<float>((bits & 0x007FFFFF) | 0x3F800000) };
+		const float p{ 2.80620213f + m * (-2.30624018f + m * (1.27390807f + m * (-0.377923373f + m * 0.0458788333f))) };
+		return exponent + (m - 1.f) * p;
+	}
+
+	//2^x the other way around: the integer part goes into the exponent field, a polynomial in the fraction f in [0, 1) does the rest
+	//Least squares fit of 2^f, less than 1e-5 off relatively, everything below 2^-126 flushes to about 0
+	inline float FastExp2(float x)
+	{
+		//Written so it compiles to maxss, and shifted positive so truncating is flooring, no branches either way
+		x = x > -126.f ? x : -126.f;
+		const int whole{ static_cast<int>(x + 127.f) - 127 };
+		const float f{ x - static_cast<float>(whole) };
+		const float p{ 1.00000727f + f * (0.692931415f + f * (0.241709986f + f * (0.0516670284f + f * 0.0136765608f))) };
+		return std::bit_cast<float>(std::bit_cast<uint32_t>(p) + (static_cast<uint32_t>(whole) << 23));
+	}
+
+	//base^exponent for base > 0 as exp2(exponent * log2(base)), for shading terms like specular lobes where the last few digits don't show
+	//No library call and no branches, so it inlines into the pixel loop, the error grows with the exponent: about 0.05% at 25
+	inline float FastPow(float base, float exponent)
+	{
+		return FastExp2(exponent * FastLog2(base));
+	}
+
 	inline float Remap(float input, float min, float max)
 	{
 		// Clamp gives a value between min & max
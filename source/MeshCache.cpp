@@ -0,0 +1,222 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace dae
+{
+	namespace MeshCache
+	{
+		namespace
+		{
+			constexpr char magic[4]{ 'D', 'M', 'S', 'H' };
+			//Goes up whenever ParseOBJ or MeshOptimizer start giving other vertices for the same file, or the header changes
+			constexpr uint32_t version{ 5 };
+			constexpr uint64_t blobAlignment{ 64 };
+
+			static_assert(std::is_trivially_copyable_v<Vertex>, "The cache stores vertices as raw bytes");
+
+			uint64_t AlignBlob(uint64_t offset)
+			{
+				return (offset + blobAlignment - 1) & ~(blobAlignment - 1);
+			}
+
+			//FNV-1a, only needed when the modification time says the source might have changed
+			uint64_t HashFile(const MappedFile& file)
+			{
+				uint64_t hash{ 0xCBF29CE484222325ull };
+				for (size_t i{ 0 }; i < file.GetSize(); ++i)
+				{
+					hash = (hash ^ static_cast<unsigned char>(file.GetData()[i])) * 0x100000001B3ull;
+				}
+				return hash;
+			}
+
+			bool GetSourceInfo(const std::string& sourcePath, uint64_t& size, int64_t& writeTime)
+			{
+				std::error_code error{};
+				size = std::filesystem::file_size(sourcePath, error);
+				if (error)
+				{
+					return false;
+				}
+
+				writeTime = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+				return !error;
+			}
+		}
+
+		std::string GetCachePath(const std::string& sourcePath)
+		{
+			return sourcePath + ".meshcache";
+		}
+
+		bool Read(const std::string& sourcePath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding, MeshOptimizer::Report* pOptimizeReport)
+		{
+			uint64_t sourceSize{};
+			int64_t sourceWriteTime{};
+			if (!GetSourceInfo(sourcePath, sourceSize, sourceWriteTime))
+			{
+				return false;
+			}
+
+			const MappedFile cache{ GetCachePath(sourcePath) };
+			if (!cache.IsOpen() || cache.GetSize() < sizeof(Header))
+			{
+				return false;
+			}
+
+			Header header{};
+			std::memcpy(&header, cache.GetData(), sizeof(Header));
+			if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.vertexSize != sizeof(Vertex)
+				|| header.flipAxisAndWinding != uint32_t(flipAxisAndWinding) || header.isOptimizedForVertexCache != uint32_t(pOptimizeReport != nullptr)
+				|| header.sourceSize != sourceSize)
+			{
+				return false;
+			}
+
+			//A cut off or hand edited file must not send the copies below out of the mapping
+			const uint64_t cacheSize{ cache.GetSize() };
+			if (header.verticesOffset > cacheSize || header.nrVertices > (cacheSize - header.verticesOffset) / sizeof(Vertex)
+				|| header.indicesOffset > cacheSize || header.nrIndices > (cacheSize - header.indicesOffset) / sizeof(uint32_t)
+				|| header.verticesOffset % blobAlignment != 0 || header.indicesOffset % blobAlignment != 0)
+			{
+				return false;
+			}
+
+			//Touched doesn't mean changed (a checkout, a copy): then the content decides
+			if (header.sourceWriteTime != sourceWriteTime)
+			{
+				const MappedFile source{ sourcePath };
+				if (!source.IsOpen() || HashFile(source) != header.sourceHash)
+				{
+					return false;
+				}
+			}
+
+			const Vertex* pVertices{ reinterpret_cast<const Vertex*>(cache.GetData() + header.verticesOffset) };
+			const uint32_t* pIndices{ reinterpret_cast<const uint32_t*>(cache.GetData() + header.indicesOffset) };
+			const uint64_t nrVertices{ header.nrVertices };
+			if (std::any_of(pIndices, pIndices + header.nrIndices, [nrVertices](uint32_t index) { return index >= nrVertices; }))
+			{
+				return false;
+			}
+
+			vertices.assign(pVertices, pVertices + header.nrVertices);
+			indices.assign(pIndices, pIndices + header.nrIndices);
+			if (pOptimizeReport)
+			{
+				*pOptimizeReport = header.optimizeReport;
+			}
+			return true;
+		}
+
+		bool Write(const std::string& sourcePath, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool flipAxisAndWinding, const MeshOptimizer::Report* pOptimizeReport)
+		{
+			Header header{};
+			std::memcpy(header.magic, magic, sizeof(magic));
+			header.version = version;
+			header.vertexSize = sizeof(Vertex);
+			header.flipAxisAndWinding = uint32_t(flipAxisAndWinding);
+			header.isOptimizedForVertexCache = uint32_t(pOptimizeReport != nullptr);
+			if (pOptimizeReport)
+			{
+				header.optimizeReport = *pOptimizeReport;
+			}
+
+			if (!GetSourceInfo(sourcePath, header.sourceSize, header.sourceWriteTime))
+			{
+				return false;
+			}
+
+			{
+				const MappedFile source{ sourcePath };
+				if (!source.IsOpen())
+				{
+					return false;
+				}
+				header.sourceHash = HashFile(source);
+			}
+
+			header.nrVertices = vertices.size();
+			header.nrIndices = indices.size();
+			header.verticesOffset = AlignBlob(sizeof(Header));
+			header.indicesOffset = AlignBlob(header.verticesOffset + vertices.size() * sizeof(Vertex));
+
+			//Written under another name first, so a crash halfway never leaves a cache that looks complete
+			const std::string cachePath{ GetCachePath(sourcePath) };
+			const std::string tempPath{ cachePath + ".tmp" };
+			{
+				std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+				if (!file)
+				{
+					return false;
+				}
+
+				const char padding[blobAlignment]{};
+				file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+				file.write(padding, header.verticesOffset - sizeof(Header));
+				file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+				file.write(padding, header.indicesOffset - header.verticesOffset - vertices.size() * sizeof(Vertex));
+				file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+
+				if (!file)
+				{
+					file.close();
+					std::error_code error{};
+					std::filesystem::remove(tempPath, error);
+					return false;
+				}
+			}
+
+			std::error_code error{};
+			std::filesystem::rename(tempPath, cachePath, error);
+			if (error)
+			{
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+			return true;
+		}
+
+		bool LoadOBJ(const std::string& sourcePath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding, ThreadPool* pThreadPool)
+		{
+			if (Read(sourcePath, vertices, indices, flipAxisAndWinding))
+			{
+				return true;
+			}
+
+			if (!Utils::ParseOBJ(sourcePath, vertices, indices, flipAxisAndWinding, pThreadPool))
+			{
+				return false;
+			}
+
+			//A cache that can't be written (read only folder, full disk) only means the next start parses again
+			Write(sourcePath, vertices, indices, flipAxisAndWinding);
+			return true;
+		}
+
+		bool LoadOptimizedOBJ(const std::string& sourcePath, Mesh& mesh, MeshOptimizer::Report& report, bool flipAxisAndWinding, ThreadPool* pThreadPool)
+		{
+			mesh.primitiveTopology = PrimitiveTopology::TriangleList;
+			if (Read(sourcePath, mesh.vertices, mesh.indices, flipAxisAndWinding, &report))
+			{
+				return true;
+			}
+
+			if (!Utils::ParseOBJ(sourcePath, mesh.vertices, mesh.indices, flipAxisAndWinding, pThreadPool))
+			{
+				return false;
+			}
+
+			report = MeshOptimizer::OptimizeForVertexCache(mesh);
+			Write(sourcePath, mesh.vertices, mesh.indices, flipAxisAndWinding, &report);
+			return true;
+		}
+	}
+}
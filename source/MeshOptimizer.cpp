@@ -0,0 +1,198 @@
+#include "MeshOptimizer.h"
+#include "VertexCache.h"
+
+#include <utility>
+
+namespace dae
+{
+	namespace MeshOptimizer
+	{
+		float ComputeACMR(const std::vector<uint32_t>& indices)
+		{
+			if (indices.size() < 3)
+			{
+				return 0.f;
+			}
+
+			VertexCache cache{};
+			for (const uint32_t index : indices)
+			{
+				cache.Lookup(index);
+			}
+
+			const uint32_t nrMisses{ cache.GetNrLookups() - cache.GetNrHits() };
+			return static_cast<float>(nrMisses) / static_cast<float>(indices.size() / 3);
+		}
+
+		void OptimizeTriangleOrder(std::vector<uint32_t>& indices, size_t nrVertices)
+		{
+			const int cacheSize{ VertexCache::m_Size };
+			const size_t nrTriangles{ indices.size() / 3 };
+			if (nrTriangles == 0)
+			{
+				return;
+			}
+
+			//Triangles around every vertex, all in one array: the ones of vertex v start at adjacencyOffsets[v]
+			std::vector<uint32_t> nrLiveTriangles(nrVertices);
+			for (const uint32_t index : indices)
+			{
+				++nrLiveTriangles[index];
+			}
+
+			std::vector<uint32_t> adjacencyOffsets(nrVertices + 1);
+			for (size_t vertex{ 0 }; vertex < nrVertices; ++vertex)
+			{
+				adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + nrLiveTriangles[vertex];
+			}
+
+			std::vector<uint32_t> adjacency(indices.size());
+			std::vector<uint32_t> adjacencyEnds(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t triangle{ 0 }; triangle < nrTriangles; ++triangle)
+			{
+				for (size_t corner{ 0 }; corner < 3; ++corner)
+				{
+					adjacency[adjacencyEnds[indices[triangle * 3 + corner]]++] = static_cast<uint32_t>(triangle);
+				}
+			}
+
+			//A vertex is in the cache when it was transformed less than cacheSize misses ago
+			std::vector<int> cacheTimeStamps(nrVertices);
+			int time{ cacheSize + 1 };
+
+			std::vector<bool> isEmitted(nrTriangles);
+			std::vector<uint32_t> deadEndStack{};
+			std::vector<uint32_t> candidates{};
+			size_t nextVertexCursor{ 0 };
+
+			std::vector<uint32_t> optimizedIndices{};
+			optimizedIndices.reserve(indices.size());
+
+			int fanningVertex{ 0 };
+			while (fanningVertex >= 0)
+			{
+				//Emit every triangle around the fanning vertex that isn't out yet
+				candidates.clear();
+				for (uint32_t adjacencyIndex{ adjacencyOffsets[fanningVertex] }; adjacencyIndex < adjacencyOffsets[fanningVertex + 1]; ++adjacencyIndex)
+				{
+					const uint32_t triangle{ adjacency[adjacencyIndex] };
+					if (isEmitted[triangle])
+					{
+						continue;
+					}
+					isEmitted[triangle] = true;
+
+					for (size_t corner{ 0 }; corner < 3; ++corner)
+					{
+						const uint32_t vertex{ indices[triangle * 3 + corner] };
+						optimizedIndices.push_back(vertex);
+						deadEndStack.push_back(vertex);
+						candidates.push_back(vertex);
+						--nrLiveTriangles[vertex];
+
+						if (time - cacheTimeStamps[vertex] > cacheSize)
+						{
+							cacheTimeStamps[vertex] = time++;
+						}
+					}
+				}
+
+				//Next fan around the candidate that stays in the cache longest while its remaining triangles go out
+				fanningVertex = -1;
+				int bestPriority{ -1 };
+				for (const uint32_t vertex : candidates)
+				{
+					if (nrLiveTriangles[vertex] == 0)
+					{
+						continue;
+					}
+
+					int priority{ 0 };
+					if (time - cacheTimeStamps[vertex] + 2 * static_cast<int>(nrLiveTriangles[vertex]) <= cacheSize)
+					{
+						priority = time - cacheTimeStamps[vertex];
+					}
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						fanningVertex = static_cast<int>(vertex);
+					}
+				}
+
+				if (fanningVertex >= 0)
+				{
+					continue;
+				}
+
+				//Dead end: go back to a recently used vertex that still has triangles, and only then to the next one in order
+				while (!deadEndStack.empty() && fanningVertex < 0)
+				{
+					const uint32_t vertex{ deadEndStack.back() };
+					deadEndStack.pop_back();
+					if (nrLiveTriangles[vertex] > 0)
+					{
+						fanningVertex = static_cast<int>(vertex);
+					}
+				}
+
+				for (; nextVertexCursor < nrVertices && fanningVertex < 0; ++nextVertexCursor)
+				{
+					if (nrLiveTriangles[nextVertexCursor] > 0)
+					{
+						fanningVertex = static_cast<int>(nextVertexCursor);
+					}
+				}
+			}
+
+			indices = std::move(optimizedIndices);
+		}
+
+		void OptimizeVertexOrder(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			std::vector<uint32_t> newIndices(vertices.size(), UINT32_MAX);
+			uint32_t nextIndex{ 0 };
+
+			for (uint32_t& index : indices)
+			{
+				if (newIndices[index] == UINT32_MAX)
+				{
+					newIndices[index] = nextIndex++;
+				}
+				index = newIndices[index];
+			}
+
+			//Vertices no triangle uses go to the back
+			for (uint32_t& newIndex : newIndices)
+			{
+				if (newIndex == UINT32_MAX)
+				{
+					newIndex = nextIndex++;
+				}
+			}
+
+			std::vector<Vertex> reorderedVertices(vertices.size());
+			for (size_t oldIndex{ 0 }; oldIndex < vertices.size(); ++oldIndex)
+			{
+				reorderedVertices[newIndices[oldIndex]] = vertices[oldIndex];
+			}
+			vertices = std::move(reorderedVertices);
+		}
+
+		Report OptimizeForVertexCache(Mesh& mesh)
+		{
+			Report report{};
+			if (mesh.primitiveTopology != PrimitiveTopology::TriangleList)
+			{
+				return report;
+			}
+
+			report.acmrBefore = ComputeACMR(mesh.indices);
+
+			OptimizeTriangleOrder(mesh.indices, mesh.vertices.size());
+			OptimizeVertexOrder(mesh.vertices, mesh.indices);
+
+			report.acmrAfter = ComputeACMR(mesh.indices);
+			return report;
+		}
+	}
+}
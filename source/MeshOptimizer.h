@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Load time passes that reorder a mesh for the post-transform vertex cache, the rendered result stays the same
+	namespace MeshOptimizer
+	{
+		//Average cache miss ratio of a triangle list: vertex transforms per triangle with a VertexCache in front, between 0.5 and 3, lower is better
+		float ComputeACMR(const std::vector<uint32_t>& indices);
+
+		//Tipsify (Sander, Nehab and Barczak 2007): emits triangle fans around vertices that are still in the cache, linear in the mesh size
+		void OptimizeTriangleOrder(std::vector<uint32_t>& indices, size_t nrVertices);
+
+		//Renumbers the vertices in the order the indices first use them, so transforming them walks memory front to back
+		void OptimizeVertexOrder(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		struct Report
+		{
+			float acmrBefore{};
+			float acmrAfter{};
+		};
+
+		//Both passes on a triangle list, other topologies are left alone
+		Report OptimizeForVertexCache(Mesh& mesh);
+	}
+}
@@ -0,0 +1,52 @@
+#include "PixelShaders.h"
+
+namespace dae
+{
+	namespace PixelShaders
+	{
+		Textured::Textured(const ShadeContext& context) :
+			m_Target{ *context.pTarget },
+			m_Material{ *context.pMaterial },
+			m_Filter{ context.textureFilter },
+			m_InstructionSet{ context.instructionSet }
+		{
+		}
+
+		void Textured::ShadeBatch()
+		{
+			// Lanes from m_NrBatched on still hold the uvs of an earlier batch or 0, both are fine to sample
+			// Diffuse is the first plane, the ones after it don't get sampled at all
+			using ShadingKernels::Diffuse;
+			m_Material.Sample(m_Batch, m_MipLevels, m_Filter, m_InstructionSet, Diffuse + 1);
+
+			for (int lane{ 0 }; lane < m_NrBatched; ++lane)
+			{
+				WriteColor(m_Target, m_PixelIndices[lane], { m_Batch.r[Diffuse][lane], m_Batch.g[Diffuse][lane], m_Batch.b[Diffuse][lane] });
+			}
+			m_NrBatched = 0;
+		}
+
+		NormalMapped::NormalMapped(const ShadeContext& context) :
+			m_Target{ *context.pTarget },
+			m_pAttributes{ context.pAttributes },
+			m_Material{ *context.pMaterial },
+			m_Filter{ context.textureFilter },
+			m_InstructionSet{ context.instructionSet },
+			m_pLightKernel{ ShadingKernels::GetLightKernel(context.instructionSet) }
+		{
+		}
+
+		void NormalMapped::ShadeBatch()
+		{
+			// Like the uvs, lanes from m_NrBatched on hold an earlier batch or 0, they get lit all the same but never written
+			m_Material.Sample(m_Batch, m_MipLevels, m_Filter, m_InstructionSet);
+			m_pLightKernel(m_Batch, m_Lights);
+
+			for (int lane{ 0 }; lane < m_NrBatched; ++lane)
+			{
+				WriteColor(m_Target, m_PixelIndices[lane], { m_Lights.r[lane], m_Lights.g[lane], m_Lights.b[lane] });
+			}
+			m_NrBatched = 0;
+		}
+	}
+}
@@ -0,0 +1,236 @@
+#pragma once
+#include <concepts>
+#include <cstdint>
+#include "DataTypes.h"
+#include "RasterKernels.h"
+#include "ShadingKernels.h"
+#include "Texture.h"
+
+namespace dae
+{
+	namespace PixelShaders
+	{
+		//Everything a shader reads or writes during one draw
+		struct ShadeContext
+		{
+			const RasterKernels::RasterTarget* pTarget{};
+			//Indexed by TriangleSetup::id, only filled in for shaders that need attributes
+			const AttributePlanes* pAttributes{};
+			//Planes as in ShadingKernels::MaterialPlane
+			const Texture* pMaterial{};
+			TextureFilter textureFilter{};
+			RasterKernels::InstructionSet instructionSet{};
+		};
+
+		//The tile loops of the renderer get instantiated per shader, so a pixel only runs the code of its shading mode and nothing gets decided per pixel
+		//Shade gets every pixel that passed the depth test in the order they passed, Flush comes after the last pixel of a tile
+		//HasRasterKernel: the SIMD triangle kernels write exactly what Shade would, the scalar loop is only their fallback
+		//NeedsAttributes: Shade reads the AttributePlanes of the triangle
+		template<typename Shader>
+		concept PixelShader = std::constructible_from<Shader, const ShadeContext&>
+			&& requires(Shader shader, const TriangleSetup& triangle, int px, int py, int pixelIdx, float depth)
+		{
+			{ Shader::HasRasterKernel } -> std::convertible_to<bool>;
+			{ Shader::NeedsAttributes } -> std::convertible_to<bool>;
+			shader.Shade(triangle, px, py, pixelIdx, depth);
+			shader.Flush();
+		};
+
+		inline void WriteColor(const RasterKernels::RasterTarget& target, int pixelIdx, ColorRGB color)
+		{
+			color.MaxToOne();
+			target.pColorBuffer[pixelIdx] = RasterKernels::PackColor(target,
+				static_cast<uint8_t>(color.r * 255),
+				static_cast<uint8_t>(color.g * 255),
+				static_cast<uint8_t>(color.b * 255));
+		}
+
+		//Perspective correct uv of a pixel and the mip level of the texture it lands in
+		//u = (u/w) / (1/w), so du/dx = (d(u/w)/dx - u * d(1/w)/dx) * w: exact derivatives for picking the mip level
+		struct TexturePixel
+		{
+			Vector2 uv{};
+			float mipLevel{};
+			//w of the pixel, for interpolating the other attributes
+			float w{};
+		};
+
+		inline TexturePixel GetTexturePixel(const TriangleSetup& triangle, float x, float y, const Texture& texture)
+		{
+			const float w{ 1.f / triangle.invW.At(x, y) };
+			const Vector2 uv{ triangle.uOverW.At(x, y) * w, triangle.vOverW.At(x, y) * w };
+			const Vector2 uvDdx{ (triangle.uOverW.stepX - uv.x * triangle.invW.stepX) * w, (triangle.vOverW.stepX - uv.y * triangle.invW.stepX) * w };
+			const Vector2 uvDdy{ (triangle.uOverW.stepY - uv.x * triangle.invW.stepY) * w, (triangle.vOverW.stepY - uv.y * triangle.invW.stepY) * w };
+			return { uv, texture.ComputeMipLevel(uvDdx, uvDdy), w };
+		}
+
+		//The depth buffer visualization
+		class DepthOnly final
+		{
+		public:
+			static constexpr bool HasRasterKernel{ true };
+			static constexpr bool NeedsAttributes{ false };
+
+			explicit DepthOnly(const ShadeContext& context) : m_Target{ *context.pTarget } {}
+
+			void Shade(const TriangleSetup&, int, int, int pixelIdx, float depth) const
+			{
+				const float depthCol{ Remap(depth, RasterKernels::DepthRemapMin, RasterKernels::DepthRemapMax) };
+				WriteColor(m_Target, pixelIdx, { depthCol, depthCol, depthCol });
+			}
+			void Flush() const {}
+
+		private:
+			const RasterKernels::RasterTarget& m_Target;
+		};
+
+		//Raster pass of deferred shading, only keeps which triangle owns the pixel
+		//The kernels write the ids themselves as long as the target has a visibility buffer
+		class Visibility final
+		{
+		public:
+			static constexpr bool HasRasterKernel{ true };
+			static constexpr bool NeedsAttributes{ false };
+
+			explicit Visibility(const ShadeContext& context) : m_pVisibilityBuffer{ context.pTarget->pVisibilityBuffer } {}
+
+			void Shade(const TriangleSetup& triangle, int, int, int pixelIdx, float) const
+			{
+				m_pVisibilityBuffer[pixelIdx] = triangle.id;
+			}
+			void Flush() const {}
+
+		private:
+			uint32_t* m_pVisibilityBuffer;
+		};
+
+		//Perspective correct vertex colors
+		class VertexColor final
+		{
+		public:
+			static constexpr bool HasRasterKernel{ false };
+			static constexpr bool NeedsAttributes{ true };
+
+			explicit VertexColor(const ShadeContext& context) : m_Target{ *context.pTarget }, m_pAttributes{ context.pAttributes } {}
+
+			void Shade(const TriangleSetup& triangle, int px, int py, int pixelIdx, float) const
+			{
+				const float x{ static_cast<float>(px) };
+				const float y{ static_cast<float>(py) };
+				const float w{ 1.f / triangle.invW.At(x, y) };
+
+				const AttributePlanes& attributes{ m_pAttributes[triangle.id] };
+				WriteColor(m_Target, pixelIdx, { attributes.colorOverW[0].At(x, y) * w, attributes.colorOverW[1].At(x, y) * w, attributes.colorOverW[2].At(x, y) * w });
+			}
+			void Flush() const {}
+
+		private:
+			const RasterKernels::RasterTarget& m_Target;
+			const AttributePlanes* m_pAttributes;
+		};
+
+		//Diffuse plane of the material with mip levels picked from the exact uv derivatives, sampled 8 pixels at a time
+		class Textured final
+		{
+		public:
+			static constexpr bool HasRasterKernel{ false };
+			static constexpr bool NeedsAttributes{ false };
+
+			explicit Textured(const ShadeContext& context);
+
+			void Shade(const TriangleSetup& triangle, int px, int py, int pixelIdx, float)
+			{
+				const TexturePixel pixel{ GetTexturePixel(triangle, static_cast<float>(px), static_cast<float>(py), m_Material) };
+				m_Batch.u[m_NrBatched] = pixel.uv.x;
+				m_Batch.v[m_NrBatched] = pixel.uv.y;
+				m_MipLevels[m_NrBatched] = pixel.mipLevel;
+				m_PixelIndices[m_NrBatched] = pixelIdx;
+				if (++m_NrBatched == TextureKernels::BatchSize)
+				{
+					ShadeBatch();
+				}
+			}
+			void Flush()
+			{
+				if (m_NrBatched > 0)
+				{
+					ShadeBatch();
+				}
+			}
+
+		private:
+			const RasterKernels::RasterTarget& m_Target;
+			const Texture& m_Material;
+			TextureFilter m_Filter;
+			RasterKernels::InstructionSet m_InstructionSet;
+
+			TextureKernels::SampleBatch m_Batch{};
+			float m_MipLevels[TextureKernels::BatchSize]{};
+			int m_PixelIndices[TextureKernels::BatchSize]{};
+			int m_NrBatched{ 0 };
+
+			//Samples the texture for the batched pixels, writes their colors and empties the batch
+			void ShadeBatch();
+		};
+
+		//Lambert plus Phong with the normal from a tangent space normal map, one directional light, lit 8 pixels at a time
+		//The four maps are the planes of one material texture, so a batch finds all of them with a single address per texel
+		class NormalMapped final
+		{
+		public:
+			static constexpr bool HasRasterKernel{ false };
+			static constexpr bool NeedsAttributes{ true };
+
+			explicit NormalMapped(const ShadeContext& context);
+
+			void Shade(const TriangleSetup& triangle, int px, int py, int pixelIdx, float)
+			{
+				const float x{ static_cast<float>(px) };
+				const float y{ static_cast<float>(py) };
+				const TexturePixel pixel{ GetTexturePixel(triangle, x, y, m_Material) };
+				m_Batch.u[m_NrBatched] = pixel.uv.x;
+				m_Batch.v[m_NrBatched] = pixel.uv.y;
+				m_MipLevels[m_NrBatched] = pixel.mipLevel;
+				m_PixelIndices[m_NrBatched] = pixelIdx;
+
+				//Lighting happens per batch, here they only get interpolated
+				const AttributePlanes& attributes{ m_pAttributes[triangle.id] };
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					m_Lights.normal[axis][m_NrBatched] = attributes.normalOverW[axis].At(x, y) * pixel.w;
+					m_Lights.tangent[axis][m_NrBatched] = attributes.tangentOverW[axis].At(x, y) * pixel.w;
+					m_Lights.viewDirection[axis][m_NrBatched] = attributes.viewDirectionOverW[axis].At(x, y) * pixel.w;
+				}
+
+				if (++m_NrBatched == TextureKernels::BatchSize)
+				{
+					ShadeBatch();
+				}
+			}
+			void Flush()
+			{
+				if (m_NrBatched > 0)
+				{
+					ShadeBatch();
+				}
+			}
+
+		private:
+			const RasterKernels::RasterTarget& m_Target;
+			const AttributePlanes* m_pAttributes;
+			const Texture& m_Material;
+			TextureFilter m_Filter;
+			RasterKernels::InstructionSet m_InstructionSet;
+			ShadingKernels::LightKernel m_pLightKernel;
+
+			TextureKernels::SampleBatch m_Batch{};
+			ShadingKernels::LightBatch m_Lights{};
+			float m_MipLevels[TextureKernels::BatchSize]{};
+			int m_PixelIndices[TextureKernels::BatchSize]{};
+			int m_NrBatched{ 0 };
+
+			//Samples all four maps for the batched pixels, lights them, writes their colors and empties the batch
+			void ShadeBatch();
+		};
+	}
+}
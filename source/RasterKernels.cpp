@@ -0,0 +1,453 @@
+#include "RasterKernels.h"
+
+#include <algorithm>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace dae
+{
+	namespace RasterKernels
+	{
+		namespace
+		{
+			void CpuId(int leaf, int subLeaf, int registers[4])
+			{
+#ifdef _MSC_VER
+				__cpuidex(registers, leaf, subLeaf);
+#else
+				unsigned int a{}, b{}, c{}, d{};
+				__cpuid_count(leaf, subLeaf, a, b, c, d);
+				registers[0] = static_cast<int>(a);
+				registers[1] = static_cast<int>(b);
+				registers[2] = static_cast<int>(c);
+				registers[3] = static_cast<int>(d);
+#endif
+			}
+
+			uint64_t ReadXCR0()
+			{
+#ifdef _MSC_VER
+				return _xgetbv(0);
+#else
+				uint32_t low{}, high{};
+				__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+				return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+			}
+
+			DAE_TARGET_AVX2 float HorizontalMax(__m256 values)
+			{
+				__m128 max{ _mm_max_ps(_mm256_castps256_ps128(values), _mm256_extractf128_ps(values, 1)) };
+				max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+				max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+				return _mm_cvtss_f32(max);
+			}
+		}
+
+		InstructionSet DetectInstructionSet()
+		{
+			int registers[4]{};
+			CpuId(0, 0, registers);
+			const int maxLeaf{ registers[0] };
+
+			CpuId(1, 0, registers);
+			const bool hasSSE41{ (registers[2] & (1 << 19)) != 0 };
+			const bool hasOSXSave{ (registers[2] & (1 << 27)) != 0 };
+			const bool hasAVX{ (registers[2] & (1 << 28)) != 0 };
+
+			//AVX registers are only usable when the OS saves them on a context switch
+			const bool osSavesYmm{ hasOSXSave && (ReadXCR0() & 0x6) == 0x6 };
+
+			bool hasAVX2{ false };
+			if (maxLeaf >= 7)
+			{
+				CpuId(7, 0, registers);
+				hasAVX2 = (registers[1] & (1 << 5)) != 0;
+			}
+
+			if (hasAVX && hasAVX2 && osSavesYmm)
+			{
+				return InstructionSet::AVX2;
+			}
+			if (hasSSE41)
+			{
+				return InstructionSet::SSE41;
+			}
+			return InstructionSet::Scalar;
+		}
+
+		const char* GetName(InstructionSet instructionSet)
+		{
+			switch (instructionSet)
+			{
+			case InstructionSet::SSE41:
+				return "SSE4.1";
+			case InstructionSet::AVX2:
+				return "AVX2";
+			default:
+				return "Scalar";
+			}
+		}
+
+		TriangleKernel GetTriangleKernel(InstructionSet instructionSet)
+		{
+			switch (instructionSet)
+			{
+			case InstructionSet::SSE41:
+				return &RasterizeTriangleSSE41;
+			case InstructionSet::AVX2:
+				return &RasterizeTriangleAVX2;
+			default:
+				return nullptr;
+			}
+		}
+
+		float ComputeRowMaxDepth(const RasterTarget& target, int blockX, int py)
+		{
+			const int endX{ std::min(blockX + HiZBlockSize, target.width) };
+			const float* pDepthRow{ target.pDepthBuffer + py * target.stride };
+
+			float maxDepth{ 0.f };
+			for (int px{ blockX }; px < endX; ++px)
+			{
+				maxDepth = std::max(maxDepth, pDepthRow[px]);
+			}
+			return maxDepth;
+		}
+
+		float UpdateBlockMaxDepth(const RasterTarget& target, int blockX, int blockY)
+		{
+			const float* pRowMaxDepths{ GetRowMaxDepths(target, blockX, blockY) };
+			float maxDepth{ 0.f };
+			for (int row{ 0 }; row < HiZBlockSize; ++row)
+			{
+				maxDepth = std::max(maxDepth, pRowMaxDepths[row]);
+			}
+
+			//Depth only ever gets lower, so an equal max means the pixels holding it are still there
+			float& blockMaxDepth{ target.pBlockMaxDepth[blockX / HiZBlockSize + (blockY / HiZBlockSize) * target.blockStride] };
+			if (maxDepth >= blockMaxDepth)
+			{
+				return 0.f;
+			}
+			const float previousMaxDepth{ blockMaxDepth };
+			blockMaxDepth = maxDepth;
+			return previousMaxDepth;
+		}
+
+		DAE_TARGET_SSE41 float RasterizeTriangleSSE41(const TriangleSetup& triangle, const RasterTarget& target, const Int2& tileTopLeft, const Int2& tileBotRight)
+		{
+			const int startX{	std::max(triangle.boundTopLeft.x, tileTopLeft.x) };
+			const int endX{		std::min(triangle.boundBotRight.x, tileBotRight.x) };
+			const int startY{	std::max(triangle.boundTopLeft.y, tileTopLeft.y) };
+			const int endY{		std::min(triangle.boundBotRight.y, tileBotRight.y) };
+			const int spanOriginX{ startX & ~7 };
+
+			const __m128 laneOffsets{ _mm_setr_ps(0.f, 1.f, 2.f, 3.f) };
+			const __m128i laneIndices{ _mm_setr_epi32(0, 1, 2, 3) };
+			const __m128i startXMinusOne{ _mm_set1_epi32(startX - 1) };
+			const __m128i endXVector{ _mm_set1_epi32(endX) };
+
+			const __m128 edgeStepX0{ _mm_set1_ps(triangle.edgeStepX[0]) };
+			const __m128 edgeStepX1{ _mm_set1_ps(triangle.edgeStepX[1]) };
+			const __m128 edgeStepX2{ _mm_set1_ps(triangle.edgeStepX[2]) };
+			const __m128 invArea{ _mm_set1_ps(triangle.invArea) };
+			const __m128 invDepth0{ _mm_set1_ps(triangle.invDepth[0]) };
+			const __m128 invDepth1{ _mm_set1_ps(triangle.invDepth[1]) };
+			const __m128 invDepth2{ _mm_set1_ps(triangle.invDepth[2]) };
+			const __m128 minDepth{ _mm_set1_ps(triangle.minDepth) };
+
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 remapMin{ _mm_set1_ps(DepthRemapMin) };
+			const __m128 remapMax{ _mm_set1_ps(DepthRemapMax) };
+			const __m128 remapRange{ _mm_set1_ps(DepthRemapMax - DepthRemapMin) };
+			const __m128 colorScale{ _mm_set1_ps(255.f) };
+
+			const __m128i redShift{ _mm_cvtsi32_si128(target.redShift) };
+			const __m128i greenShift{ _mm_cvtsi32_si128(target.greenShift) };
+			const __m128i blueShift{ _mm_cvtsi32_si128(target.blueShift) };
+			const __m128i redLoss{ _mm_cvtsi32_si128(target.redLoss) };
+			const __m128i greenLoss{ _mm_cvtsi32_si128(target.greenLoss) };
+			const __m128i blueLoss{ _mm_cvtsi32_si128(target.blueLoss) };
+			const __m128i alphaMask{ _mm_set1_epi32(static_cast<int>(target.alphaMask)) };
+
+			//Deferred shading only stores which triangle owns the pixel, the color comes later
+			const bool writeId{ target.pVisibilityBuffer != nullptr };
+			uint32_t* pPixels{ writeId ? target.pVisibilityBuffer : target.pColorBuffer };
+			const __m128i triangleId{ _mm_set1_epi32(static_cast<int>(triangle.id)) };
+
+			float rowEdge0{ triangle.edgeStepX[0] * spanOriginX + triangle.edgeStepY[0] * startY + triangle.edgeOffset[0] };
+			float rowEdge1{ triangle.edgeStepX[1] * spanOriginX + triangle.edgeStepY[1] * startY + triangle.edgeOffset[1] };
+			float rowEdge2{ triangle.edgeStepX[2] * spanOriginX + triangle.edgeStepY[2] * startY + triangle.edgeOffset[2] };
+
+			float loweredMaxDepth{ 0.f };
+			for (int blockY{ startY & ~(HiZBlockSize - 1) }; blockY < endY; blockY += HiZBlockSize)
+			{
+				const int rowStart{ std::max(blockY, startY) };
+				const int nrRows{ std::min(blockY + HiZBlockSize, endY) - rowStart };
+
+				__m128 blockRowEdge0[HiZBlockSize];
+				__m128 blockRowEdge1[HiZBlockSize];
+				__m128 blockRowEdge2[HiZBlockSize];
+				for (int row{ 0 }; row < nrRows; ++row)
+				{
+					blockRowEdge0[row] = _mm_set1_ps(rowEdge0);
+					blockRowEdge1[row] = _mm_set1_ps(rowEdge1);
+					blockRowEdge2[row] = _mm_set1_ps(rowEdge2);
+
+					rowEdge0 += triangle.edgeStepY[0];
+					rowEdge1 += triangle.edgeStepY[1];
+					rowEdge2 += triangle.edgeStepY[2];
+				}
+
+				const float* pBlockMaxRow{ target.pBlockMaxDepth + (blockY / HiZBlockSize) * target.blockStride };
+				for (int blockX{ spanOriginX }; blockX < endX; blockX += HiZBlockSize)
+				{
+					//Hi-Z: the whole block already holds something closer than the closest point of the triangle
+					if (triangle.minDepth > pBlockMaxRow[blockX / HiZBlockSize])
+					{
+						continue;
+					}
+					float* pRowMaxDepths{ GetRowMaxDepths(target, blockX, blockY) };
+
+					bool wroteBlock{ false };
+					for (int row{ 0 }; row < nrRows; ++row)
+					{
+						float* pDepthRow{ target.pDepthBuffer + (rowStart + row) * target.stride };
+						uint32_t* pPixelRow{ pPixels + (rowStart + row) * target.stride };
+
+						bool wroteRow{ false };
+						for (int spanX{ blockX }; spanX < blockX + HiZBlockSize && spanX < endX; spanX += 4)
+						{
+							const __m128 offsets{ _mm_add_ps(_mm_set1_ps(static_cast<float>(spanX - spanOriginX)), laneOffsets) };
+							const __m128 edge0{ _mm_add_ps(blockRowEdge0[row], _mm_mul_ps(edgeStepX0, offsets)) };
+							const __m128 edge1{ _mm_add_ps(blockRowEdge1[row], _mm_mul_ps(edgeStepX1, offsets)) };
+							const __m128 edge2{ _mm_add_ps(blockRowEdge2[row], _mm_mul_ps(edgeStepX2, offsets)) };
+
+							const __m128i pixelX{ _mm_add_epi32(_mm_set1_epi32(spanX), laneIndices) };
+							const __m128i insideSpan{ _mm_and_si128(_mm_cmpgt_epi32(pixelX, startXMinusOne), _mm_cmpgt_epi32(endXVector, pixelX)) };
+
+							__m128 coverage{ _mm_castsi128_ps(insideSpan) };
+							coverage = _mm_and_ps(coverage, _mm_cmpge_ps(edge0, zero));
+							coverage = _mm_and_ps(coverage, _mm_cmpge_ps(edge1, zero));
+							coverage = _mm_and_ps(coverage, _mm_cmpge_ps(edge2, zero));
+							if (_mm_movemask_ps(coverage) == 0)
+							{
+								continue;
+							}
+
+							const __m128 weight0{ _mm_mul_ps(edge0, invArea) };
+							const __m128 weight1{ _mm_mul_ps(edge1, invArea) };
+							const __m128 weight2{ _mm_mul_ps(edge2, invArea) };
+							//Rounding can take the interpolated depth below every vertex, clamped it never beats what Hi-Z rejected on
+							const __m128 interpolatedDepth{ _mm_max_ps(_mm_div_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(invDepth0, weight0), _mm_mul_ps(invDepth1, weight1)), _mm_mul_ps(invDepth2, weight2))), minDepth) };
+
+							//Spans only run past the triangle into pixels of this same tile (or the row padding), so a full aligned load and blended store is safe
+							const __m128 storedDepth{ _mm_load_ps(pDepthRow + spanX) };
+
+							__m128 failed{ _mm_cmplt_ps(storedDepth, interpolatedDepth) };
+							failed = _mm_or_ps(failed, _mm_cmplt_ps(interpolatedDepth, zero));
+							failed = _mm_or_ps(failed, _mm_cmpgt_ps(interpolatedDepth, one));
+							const __m128 passed{ _mm_andnot_ps(failed, coverage) };
+							if (_mm_movemask_ps(passed) == 0)
+							{
+								continue;
+							}
+
+							__m128i pixel{ triangleId };
+							if (!writeId)
+							{
+								const __m128 depthColor{ _mm_div_ps(_mm_sub_ps(_mm_min_ps(_mm_max_ps(interpolatedDepth, remapMin), remapMax), remapMin), remapRange) };
+								const __m128i gray{ _mm_cvttps_epi32(_mm_mul_ps(depthColor, colorScale)) };
+
+								pixel = _mm_sll_epi32(_mm_srl_epi32(gray, redLoss), redShift);
+								pixel = _mm_or_si128(pixel, _mm_sll_epi32(_mm_srl_epi32(gray, greenLoss), greenShift));
+								pixel = _mm_or_si128(pixel, _mm_sll_epi32(_mm_srl_epi32(gray, blueLoss), blueShift));
+								pixel = _mm_or_si128(pixel, alphaMask);
+							}
+
+							_mm_store_ps(pDepthRow + spanX, _mm_blendv_ps(storedDepth, interpolatedDepth, passed));
+
+							const __m128i storedPixel{ _mm_load_si128(reinterpret_cast<const __m128i*>(pPixelRow + spanX)) };
+							_mm_store_si128(reinterpret_cast<__m128i*>(pPixelRow + spanX), _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(storedPixel), _mm_castsi128_ps(pixel), passed)));
+							wroteRow = true;
+						}
+
+						if (wroteRow)
+						{
+							pRowMaxDepths[rowStart + row - blockY] = ComputeRowMaxDepth(target, blockX, rowStart + row);
+							wroteBlock = true;
+						}
+					}
+
+					if (wroteBlock)
+					{
+						loweredMaxDepth = std::max(loweredMaxDepth, UpdateBlockMaxDepth(target, blockX, blockY));
+					}
+				}
+			}
+			return loweredMaxDepth;
+		}
+
+		DAE_TARGET_AVX2 float RasterizeTriangleAVX2(const TriangleSetup& triangle, const RasterTarget& target, const Int2& tileTopLeft, const Int2& tileBotRight)
+		{
+			const int startX{	std::max(triangle.boundTopLeft.x, tileTopLeft.x) };
+			const int endX{		std::min(triangle.boundBotRight.x, tileBotRight.x) };
+			const int startY{	std::max(triangle.boundTopLeft.y, tileTopLeft.y) };
+			const int endY{		std::min(triangle.boundBotRight.y, tileBotRight.y) };
+			const int spanOriginX{ startX & ~7 };
+
+			const __m256 laneOffsets{ _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+			const __m256i laneIndices{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+			const __m256i startXMinusOne{ _mm256_set1_epi32(startX - 1) };
+			const __m256i endXVector{ _mm256_set1_epi32(endX) };
+
+			const __m256 edgeStepX0{ _mm256_set1_ps(triangle.edgeStepX[0]) };
+			const __m256 edgeStepX1{ _mm256_set1_ps(triangle.edgeStepX[1]) };
+			const __m256 edgeStepX2{ _mm256_set1_ps(triangle.edgeStepX[2]) };
+			const __m256 invArea{ _mm256_set1_ps(triangle.invArea) };
+			const __m256 invDepth0{ _mm256_set1_ps(triangle.invDepth[0]) };
+			const __m256 invDepth1{ _mm256_set1_ps(triangle.invDepth[1]) };
+			const __m256 invDepth2{ _mm256_set1_ps(triangle.invDepth[2]) };
+			const __m256 minDepth{ _mm256_set1_ps(triangle.minDepth) };
+			const __m256i widthVector{ _mm256_set1_epi32(target.width) };
+
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 remapMin{ _mm256_set1_ps(DepthRemapMin) };
+			const __m256 remapMax{ _mm256_set1_ps(DepthRemapMax) };
+			const __m256 remapRange{ _mm256_set1_ps(DepthRemapMax - DepthRemapMin) };
+			const __m256 colorScale{ _mm256_set1_ps(255.f) };
+
+			const __m128i redShift{ _mm_cvtsi32_si128(target.redShift) };
+			const __m128i greenShift{ _mm_cvtsi32_si128(target.greenShift) };
+			const __m128i blueShift{ _mm_cvtsi32_si128(target.blueShift) };
+			const __m128i redLoss{ _mm_cvtsi32_si128(target.redLoss) };
+			const __m128i greenLoss{ _mm_cvtsi32_si128(target.greenLoss) };
+			const __m128i blueLoss{ _mm_cvtsi32_si128(target.blueLoss) };
+			const __m256i alphaMask{ _mm256_set1_epi32(static_cast<int>(target.alphaMask)) };
+
+			//Deferred shading only stores which triangle owns the pixel, the color comes later
+			const bool writeId{ target.pVisibilityBuffer != nullptr };
+			uint32_t* pPixels{ writeId ? target.pVisibilityBuffer : target.pColorBuffer };
+			const __m256i triangleId{ _mm256_set1_epi32(static_cast<int>(triangle.id)) };
+
+			float rowEdge0{ triangle.edgeStepX[0] * spanOriginX + triangle.edgeStepY[0] * startY + triangle.edgeOffset[0] };
+			float rowEdge1{ triangle.edgeStepX[1] * spanOriginX + triangle.edgeStepY[1] * startY + triangle.edgeOffset[1] };
+			float rowEdge2{ triangle.edgeStepX[2] * spanOriginX + triangle.edgeStepY[2] * startY + triangle.edgeOffset[2] };
+
+			float loweredMaxDepth{ 0.f };
+			for (int blockY{ startY & ~(HiZBlockSize - 1) }; blockY < endY; blockY += HiZBlockSize)
+			{
+				const int rowStart{ std::max(blockY, startY) };
+				const int nrRows{ std::min(blockY + HiZBlockSize, endY) - rowStart };
+
+				__m256 blockRowEdge0[HiZBlockSize];
+				__m256 blockRowEdge1[HiZBlockSize];
+				__m256 blockRowEdge2[HiZBlockSize];
+				for (int row{ 0 }; row < nrRows; ++row)
+				{
+					blockRowEdge0[row] = _mm256_set1_ps(rowEdge0);
+					blockRowEdge1[row] = _mm256_set1_ps(rowEdge1);
+					blockRowEdge2[row] = _mm256_set1_ps(rowEdge2);
+
+					rowEdge0 += triangle.edgeStepY[0];
+					rowEdge1 += triangle.edgeStepY[1];
+					rowEdge2 += triangle.edgeStepY[2];
+				}
+
+				const float* pBlockMaxRow{ target.pBlockMaxDepth + (blockY / HiZBlockSize) * target.blockStride };
+				for (int blockX{ spanOriginX }; blockX < endX; blockX += HiZBlockSize)
+				{
+					//Hi-Z: the whole block already holds something closer than the closest point of the triangle
+					if (triangle.minDepth > pBlockMaxRow[blockX / HiZBlockSize])
+					{
+						continue;
+					}
+					float* pRowMaxDepths{ GetRowMaxDepths(target, blockX, blockY) };
+
+					//A block row is exactly one 8 wide span
+					const __m256 offsets{ _mm256_add_ps(_mm256_set1_ps(static_cast<float>(blockX - spanOriginX)), laneOffsets) };
+					const __m256 edgeColumn0{ _mm256_mul_ps(edgeStepX0, offsets) };
+					const __m256 edgeColumn1{ _mm256_mul_ps(edgeStepX1, offsets) };
+					const __m256 edgeColumn2{ _mm256_mul_ps(edgeStepX2, offsets) };
+
+					const __m256i pixelX{ _mm256_add_epi32(_mm256_set1_epi32(blockX), laneIndices) };
+					const __m256 insideSpan{ _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(pixelX, startXMinusOne), _mm256_cmpgt_epi32(endXVector, pixelX))) };
+					const __m256 onScreen{ _mm256_castsi256_ps(_mm256_cmpgt_epi32(widthVector, pixelX)) };
+
+					bool wroteBlock{ false };
+					for (int row{ 0 }; row < nrRows; ++row)
+					{
+						float* pDepthRow{ target.pDepthBuffer + (rowStart + row) * target.stride };
+						uint32_t* pPixelRow{ pPixels + (rowStart + row) * target.stride };
+
+						const __m256 edge0{ _mm256_add_ps(blockRowEdge0[row], edgeColumn0) };
+						const __m256 edge1{ _mm256_add_ps(blockRowEdge1[row], edgeColumn1) };
+						const __m256 edge2{ _mm256_add_ps(blockRowEdge2[row], edgeColumn2) };
+
+						__m256 coverage{ insideSpan };
+						coverage = _mm256_and_ps(coverage, _mm256_cmp_ps(edge0, zero, _CMP_GE_OQ));
+						coverage = _mm256_and_ps(coverage, _mm256_cmp_ps(edge1, zero, _CMP_GE_OQ));
+						coverage = _mm256_and_ps(coverage, _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ));
+						if (_mm256_movemask_ps(coverage) == 0)
+						{
+							continue;
+						}
+
+						const __m256 weight0{ _mm256_mul_ps(edge0, invArea) };
+						const __m256 weight1{ _mm256_mul_ps(edge1, invArea) };
+						const __m256 weight2{ _mm256_mul_ps(edge2, invArea) };
+						//Rounding can take the interpolated depth below every vertex, clamped it never beats what Hi-Z rejected on
+						const __m256 interpolatedDepth{ _mm256_max_ps(_mm256_div_ps(one, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(invDepth0, weight0), _mm256_mul_ps(invDepth1, weight1)), _mm256_mul_ps(invDepth2, weight2))), minDepth) };
+
+						//The whole block row lies in this tile (or the row padding), so it gets loaded in full for the row max
+						//Masked stores never touch lanes outside the triangle span
+						const __m256 storedDepth{ _mm256_load_ps(pDepthRow + blockX) };
+
+						__m256 failed{ _mm256_cmp_ps(storedDepth, interpolatedDepth, _CMP_LT_OQ) };
+						failed = _mm256_or_ps(failed, _mm256_cmp_ps(interpolatedDepth, zero, _CMP_LT_OQ));
+						failed = _mm256_or_ps(failed, _mm256_cmp_ps(interpolatedDepth, one, _CMP_GT_OQ));
+						const __m256 passed{ _mm256_andnot_ps(failed, coverage) };
+						if (_mm256_movemask_ps(passed) == 0)
+						{
+							continue;
+						}
+
+						__m256i pixel{ triangleId };
+						if (!writeId)
+						{
+							const __m256 depthColor{ _mm256_div_ps(_mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(interpolatedDepth, remapMin), remapMax), remapMin), remapRange) };
+							const __m256i gray{ _mm256_cvttps_epi32(_mm256_mul_ps(depthColor, colorScale)) };
+
+							pixel = _mm256_sll_epi32(_mm256_srl_epi32(gray, redLoss), redShift);
+							pixel = _mm256_or_si256(pixel, _mm256_sll_epi32(_mm256_srl_epi32(gray, greenLoss), greenShift));
+							pixel = _mm256_or_si256(pixel, _mm256_sll_epi32(_mm256_srl_epi32(gray, blueLoss), blueShift));
+							pixel = _mm256_or_si256(pixel, alphaMask);
+						}
+
+						const __m256i passedMask{ _mm256_castps_si256(passed) };
+						_mm256_maskstore_ps(pDepthRow + blockX, passedMask, interpolatedDepth);
+						_mm256_maskstore_epi32(reinterpret_cast<int*>(pPixelRow + blockX), passedMask, pixel);
+
+						//Depths are never negative, so the pixels past the screen edge drop out as 0
+						pRowMaxDepths[rowStart + row - blockY] = HorizontalMax(_mm256_and_ps(_mm256_blendv_ps(storedDepth, interpolatedDepth, passed), onScreen));
+						wroteBlock = true;
+					}
+
+					if (wroteBlock)
+					{
+						loweredMaxDepth = std::max(loweredMaxDepth, UpdateBlockMaxDepth(target, blockX, blockY));
+					}
+				}
+			}
+			return loweredMaxDepth;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include "DataTypes.h"
+
+//MSVC lets every function use any intrinsic, GCC and Clang need to be told per function
+#ifdef _MSC_VER
+#define DAE_TARGET_SSE41
+#define DAE_TARGET_AVX2
+#else
+#define DAE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define DAE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace dae
+{
+	namespace RasterKernels
+	{
+		//Every kernel picked by instruction set, here and in the vertex, texture and shading kernels, does the same float operations in the same order on every path
+		//So they all give bit-identical results, Bench isa renders a frame on every path and fails when any buffer differs from Scalar
+		enum class InstructionSet
+		{
+			Scalar,
+			SSE41,
+			AVX2
+		};
+
+		//Side of the square pixel blocks the Hi-Z buffer keeps a max depth for
+		constexpr int HiZBlockSize{ 8 };
+
+		//Depth range that gets stretched over the full gray scale when visualizing the depth buffer
+		constexpr float DepthRemapMin{ 0.985f };
+		constexpr float DepthRemapMax{ 1.f };
+
+		//Buffers the kernels write to, plus the packed pixel layout of the color buffer (same math as SDL_MapRGB)
+		//Both buffers are 64 byte aligned and stride is a multiple of 16 pixels, so spans from an 8 aligned x never leave the row
+		struct RasterTarget
+		{
+			float* pDepthBuffer{};
+			uint32_t* pColorBuffer{};
+			//Deferred shading: when set, passing pixels get the triangle id here instead of their color in pColorBuffer
+			uint32_t* pVisibilityBuffer{};
+			int stride{};
+			int width{};
+			int height{};
+
+			//Hi-Z, max depth of every HiZBlockSize x HiZBlockSize block, blockStride blocks per row
+			float* pBlockMaxDepth{};
+			int blockStride{};
+			//Max depth of every row of every block, HiZBlockSize per block in the same order as the blocks
+			//Rows below the screen hold 0, so a block max is always just the max of its rows
+			float* pRowMaxDepth{};
+
+			uint8_t redShift{};
+			uint8_t greenShift{};
+			uint8_t blueShift{};
+			uint8_t redLoss{};
+			uint8_t greenLoss{};
+			uint8_t blueLoss{};
+			uint32_t alphaMask{};
+		};
+
+		//Same packing as SDL_MapRGB gives for the format of the target
+		inline uint32_t PackColor(const RasterTarget& target, uint8_t red, uint8_t green, uint8_t blue)
+		{
+			return (static_cast<uint32_t>(red >> target.redLoss) << target.redShift)
+				| (static_cast<uint32_t>(green >> target.greenLoss) << target.greenShift)
+				| (static_cast<uint32_t>(blue >> target.blueLoss) << target.blueShift)
+				| target.alphaMask;
+		}
+
+		//Rasterizes the part of the triangle inside the tile
+		//Returns the max depth the highest block it lowered had before, 0 when it lowered none, the tile max can only have dropped when that was it
+		//Every kernel walks Hi-Z blocks row by row in spans starting from the bounding box start rounded down to 8 pixels
+		//and evaluates the edges as rowEdge + edgeStepX * (x - spanOrigin), so all of them write bit-identical results
+		//Interpolated depths are clamped to triangle.minDepth, so skipping the blocks that already hold something closer never changes a pixel
+		//Written rows get their max depth tracked as they go, their blocks get the max of the rows
+		//Besides depth they write either the depth visualization or, with a visibility buffer, triangle.id
+		using TriangleKernel = float(*)(const TriangleSetup& triangle, const RasterTarget& target, const Int2& tileTopLeft, const Int2& tileBotRight);
+
+		InstructionSet DetectInstructionSet();
+		const char* GetName(InstructionSet instructionSet);
+
+		//Returns nullptr for Scalar, that path stays in Renderer::RenderMeshTriangle
+		TriangleKernel GetTriangleKernel(InstructionSet instructionSet);
+
+		//Row maxima of the block starting at (blockX, blockY), HiZBlockSize of them
+		inline float* GetRowMaxDepths(const RasterTarget& target, int blockX, int blockY)
+		{
+			return target.pRowMaxDepth + ((blockY / HiZBlockSize) * target.blockStride + blockX / HiZBlockSize) * HiZBlockSize;
+		}
+
+		//Max depth of the on screen pixels of the block row starting at (blockX, py)
+		float ComputeRowMaxDepth(const RasterTarget& target, int blockX, int py);
+
+		//Sets the max of the block starting at (blockX, blockY) to the max of its rows, after some of them got written
+		//Returns the max the block had before when it went down, 0 otherwise
+		float UpdateBlockMaxDepth(const RasterTarget& target, int blockX, int blockY);
+
+		float RasterizeTriangleSSE41(const TriangleSetup& triangle, const RasterTarget& target, const Int2& tileTopLeft, const Int2& tileBotRight);
+		float RasterizeTriangleAVX2(const TriangleSetup& triangle, const RasterTarget& target, const Int2& tileTopLeft, const Int2& tileBotRight);
+	}
+}
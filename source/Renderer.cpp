@@ -6,13 +6,28 @@
 #include "Renderer.h"
 #include "Math.h"
 #include "Matrix.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
 #include "Texture.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <new>
 
 using namespace dae;
 
+//Depth has nothing to defer, the raster kernels write it as they go
+const Renderer::ShadingPasses Renderer::m_ShadingPasses[]
+{
+	{ &Renderer::RenderTile<PixelShaders::DepthOnly>, nullptr, PixelShaders::DepthOnly::NeedsAttributes },
+	{ &Renderer::RenderTile<PixelShaders::VertexColor>, &Renderer::ShadeVisibleTile<PixelShaders::VertexColor>, PixelShaders::VertexColor::NeedsAttributes },
+	{ &Renderer::RenderTile<PixelShaders::Textured>, &Renderer::ShadeVisibleTile<PixelShaders::Textured>, PixelShaders::Textured::NeedsAttributes },
+	{ &Renderer::RenderTile<PixelShaders::NormalMapped>, &Renderer::ShadeVisibleTile<PixelShaders::NormalMapped>, PixelShaders::NormalMapped::NeedsAttributes }
+};
+
 Renderer::Renderer(SDL_Window* pWindow) :
 	m_pWindow(pWindow)
 {
@@ -20,33 +35,82 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 
 	//Create Buffers
+	//Both buffers start on a cache line and every row is padded to whole cache lines, so SIMD spans never straddle two lines
+	const int pixelsPerCacheLine{ m_BufferAlignment / static_cast<int>(sizeof(float)) };
+	m_Stride = (m_Width + pixelsPerCacheLine - 1) / pixelsPerCacheLine * pixelsPerCacheLine;
+
 	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+	m_pBackBufferPixels = static_cast<uint32_t*>(::operator new[](m_Stride * m_Height * sizeof(uint32_t), std::align_val_t{ m_BufferAlignment }));
+	m_pBackBuffer = SDL_CreateRGBSurfaceFrom(m_pBackBufferPixels, m_Width, m_Height, 32, m_Stride * static_cast<int>(sizeof(uint32_t)), 0, 0, 0, 0);
 
 	m_AspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
-	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	m_pDepthBufferPixels = static_cast<float*>(::operator new[](m_Stride * m_Height * sizeof(float), std::align_val_t{ m_BufferAlignment }));
+	m_pVisibilityBufferPixels = static_cast<uint32_t*>(::operator new[](m_Stride * m_Height * sizeof(uint32_t), std::align_val_t{ m_BufferAlignment }));
+
+	//Split the screen in tiles, partial tiles on the right and bottom border
+	m_NrTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NrTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+
+	//Hi-Z keeps the max depth per tile, per block and per block row, all only ever written by the thread rasterizing that tile
+	m_HiZBlockStride = m_Stride / RasterKernels::HiZBlockSize;
+	m_HiZBlockMaxDepth.resize(m_HiZBlockStride * ((m_Height + RasterKernels::HiZBlockSize - 1) / RasterKernels::HiZBlockSize));
+	m_HiZRowMaxDepth.resize(m_HiZBlockMaxDepth.size() * RasterKernels::HiZBlockSize);
+	m_HiZTileMaxDepth.resize(m_NrTilesX * m_NrTilesY);
 	ResetDepthBuffer();
 
-	//Initialize Camera
-	m_Camera.Initialize(60.f, { .0f,.5f,-30.f }, m_AspectRatio);
+	m_pThreadPool = new ThreadPool();
+
+	//Kernels pack colors themselves, with the same shifts SDL_MapRGB would use
+	m_RasterTarget.pDepthBuffer = m_pDepthBufferPixels;
+	m_RasterTarget.pColorBuffer = m_pBackBufferPixels;
+	m_RasterTarget.stride = m_Stride;
+	m_RasterTarget.width = m_Width;
+	m_RasterTarget.height = m_Height;
+	m_RasterTarget.pBlockMaxDepth = m_HiZBlockMaxDepth.data();
+	m_RasterTarget.blockStride = m_HiZBlockStride;
+	m_RasterTarget.pRowMaxDepth = m_HiZRowMaxDepth.data();
+	m_RasterTarget.redShift = m_pBackBuffer->format->Rshift;
+	m_RasterTarget.greenShift = m_pBackBuffer->format->Gshift;
+	m_RasterTarget.blueShift = m_pBackBuffer->format->Bshift;
+	m_RasterTarget.redLoss = m_pBackBuffer->format->Rloss;
+	m_RasterTarget.greenLoss = m_pBackBuffer->format->Gloss;
+	m_RasterTarget.blueLoss = m_pBackBuffer->format->Bloss;
+	m_RasterTarget.alphaMask = m_pBackBuffer->format->Amask;
+
+	m_SupportedInstructionSet = RasterKernels::DetectInstructionSet();
+	m_InstructionSet = m_SupportedInstructionSet;
+	m_pTriangleKernel = RasterKernels::GetTriangleKernel(m_InstructionSet);
+	m_pTransformKernel = VertexKernels::GetTransformKernel(m_InstructionSet);
+	m_pIndexedTransformKernel = VertexKernels::GetIndexedTransformKernel(m_InstructionSet);
+	std::cout << "Rasterizer path: " << RasterKernels::GetName(m_InstructionSet) << '\n';
 
-	m_pTexture = Texture::LoadFromFile("Resources/tuktuk.png");
-	m_pMesh = new Mesh();
+	//Initialize Camera
+	m_Camera.Initialize(45.f, { .0f,5.f,-50.f }, m_AspectRatio);
 
-	Utils::ParseOBJ("Resources/tuktuk.obj", m_pMesh->vertices, m_pMesh->indices);
+	//Same order as ShadingKernels::MaterialPlane, the textured mode samples just the diffuse plane
+	m_pMaterial = Texture::LoadFromFiles({ "Resources/vehicle_diffuse.png", "Resources/vehicle_normal.png", "Resources/vehicle_gloss.png", "Resources/vehicle_specular.png" });
+	Mesh& vehicle{ m_Meshes.emplace_back() };
+	//Reordering once saves vertex transforms every frame, the mesh cache keeps the reordered mesh so later starts skip it
+	MeshOptimizer::Report report{};
+	MeshCache::LoadOptimizedOBJ("Resources/vehicle.obj", vehicle, report, true, m_pThreadPool);
+	std::cout << "vehicle.obj ACMR: " << report.acmrBefore << " -> " << report.acmrAfter << '\n';
+	Utils::BuildVertexStreams(vehicle.vertices, vehicle.streams);
 
 }
 
 Renderer::~Renderer()
 {
-	delete[] m_pDepthBufferPixels;
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
 
-	delete m_pTexture;
-	m_pTexture = nullptr;
+	//The surface doesn't own the pixels it was created from
+	SDL_FreeSurface(m_pBackBuffer);
+	::operator delete[](m_pBackBufferPixels, std::align_val_t{ m_BufferAlignment });
+	::operator delete[](m_pDepthBufferPixels, std::align_val_t{ m_BufferAlignment });
+	::operator delete[](m_pVisibilityBufferPixels, std::align_val_t{ m_BufferAlignment });
 
-	delete m_pMesh;
-	m_pMesh = nullptr;
+	delete m_pMaterial;
+	m_pMaterial = nullptr;
 }
 
 void Renderer::Update(Timer* pTimer)
@@ -59,47 +123,76 @@ void Renderer::Render()
 	//@START
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
+	m_CullStats = {};
 
-	VertexTransformationFunction(*m_pMesh);
-	std::vector<Mesh> meshes_world{ *m_pMesh };
+	//Nothing from the previous frame is used anymore
+	m_FrameArena.Reset();
 
+	ResetDepthBuffer();
+	ClearBackground();
+
+	//Left empty while the vertex cache is off, there is nothing to count then
+	m_VertexCacheStats.resize(m_UseVertexCache ? m_Meshes.size() : 0);
+	m_TriangleSetups = FrameVector<TriangleSetup>{ m_FrameArena };
+	m_TriangleAttributes = FrameVector<AttributePlanes>{ m_FrameArena };
+
+	//Every pass of the shading mode gets picked here, once for all meshes
+	//Modes whose textures failed to load show depth instead
+	ShadingMode shadingMode{ m_ShadingMode };
+	if ((shadingMode == ShadingMode::Textured || shadingMode == ShadingMode::NormalMapped) && !m_pMaterial)
+	{
+		shadingMode = ShadingMode::Depth;
+	}
+	const ShadingPasses& shadingPasses{ m_ShadingPasses[static_cast<int>(shadingMode)] };
+	m_BuildAttributes = shadingPasses.needsAttributes;
+
+	//Deferred, the raster pass only resolves visibility and every visible pixel gets shaded once after the last mesh
+	const bool deferShading{ m_UseDeferredShading && shadingPasses.pShadeVisible };
+	m_RasterTarget.pVisibilityBuffer = deferShading ? m_pVisibilityBufferPixels : nullptr;
+	const TilePass pRasterPass{ deferShading ? &Renderer::RenderTile<PixelShaders::Visibility> : shadingPasses.pRaster };
 
 	//Go over all meshes
-	for (auto& mesh : meshes_world)
+	for (size_t meshIndex{ 0 }; meshIndex < m_Meshes.size(); ++meshIndex)
 	{
-		VertexTransformationFunction(mesh);
+		Mesh& mesh{ m_Meshes[meshIndex] };
+
+		//Meshes that only had their vertices filled in still work, their streams get built the first time around
+		if (mesh.streams.positionX.size() != mesh.vertices.size())
+		{
+			Utils::BuildVertexStreams(mesh.vertices, mesh.streams);
+		}
 
-		std::vector<Vector2> screenSpaceVertices;
-		for (const Vertex_Out& ndcVertex : mesh.vertices_out)
+		//Only shaders that interpolate attributes need the whole vertices, leave no stale vertices_out behind otherwise
+		//With the vertex cache on, BinMeshTriangles only transforms the ones that miss it
+		mesh.vertices_out = FrameVector<Vertex_Out>{ m_FrameArena };
+		if (m_BuildAttributes && !m_UseVertexCache)
 		{
-			// Formula from slides
-			// NDC --> Screenspace
-			screenSpaceVertices.push_back({ (ndcVertex.position.x + 1) / 2.0f * m_Width, (1.0f - ndcVertex.position.y) / 2.0f * m_Height });
+			VertexTransformationFunction(mesh);
 		}
 
-		ResetDepthBuffer();
-		ClearBackground();
+		FrameVector<Vector2> screenSpaceVertices{ m_FrameArena };
+		TransformMeshPositions(mesh, screenSpaceVertices);
 
 		//RENDER LOGIC
-
-		switch (mesh.primitiveTopology)
+		BinMeshTriangles(mesh, screenSpaceVertices);
+		if (m_UseVertexCache)
 		{
-		case PrimitiveTopology::TriangleList:
-			for (int index{ 0 }; index < mesh.indices.size(); index += 3)
+			m_VertexCacheStats[meshIndex] = { m_VertexCache.GetNrLookups(), m_VertexCache.GetNrHits() };
+		}
+
+		//Tiles don't share any pixels, so they can be rasterized in parallel without locking
+		m_pThreadPool->ParallelFor(static_cast<uint32_t>(m_NrTilesX * m_NrTilesY), [&](uint32_t tileIndex)
 			{
-				RenderMeshTriangle(mesh, screenSpaceVertices, index, false);
-			}
-			break;
-		case PrimitiveTopology::TriangleStrip:
-			for (int index{ 0 }; index < mesh.indices.size() - 2; ++index)
+				(this->*pRasterPass)(static_cast<int>(tileIndex));
+			});
+	}
+
+	if (deferShading)
+	{
+		m_pThreadPool->ParallelFor(static_cast<uint32_t>(m_NrTilesX * m_NrTilesY), [&](uint32_t tileIndex)
 			{
-				RenderMeshTriangle(mesh, screenSpaceVertices, index, index % 2);
-			}
-			break;
-		default:
-			std::cout << "no primitive\n";
-			break;
-		}
+				(this->*shadingPasses.pShadeVisible)(static_cast<int>(tileIndex));
+			});
 	}
 
 	//@END
@@ -124,63 +217,438 @@ void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_
 	}
 }
 
-void Renderer::VertexTransformationFunction(const std::vector<Mesh>& meshes_in, std::vector<Mesh>& meshes_out) const
+void Renderer::VertexTransformationFunction(Mesh& mesh)
+{
+	Matrix worldViewProjectionMatrix{ mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+	mesh.vertices_out = FrameVector<Vertex_Out>{ m_FrameArena };
+	mesh.vertices_out.resize(mesh.vertices.size());
+
+	// Every vertex has its own slot, so chunks can be filled in parallel without locking
+	const uint32_t nrChunks{ static_cast<uint32_t>((mesh.vertices.size() + m_VertexChunkSize - 1) / m_VertexChunkSize) };
+	m_pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIndex)
+		{
+			const size_t first{ chunkIndex * m_VertexChunkSize };
+			const size_t end{ std::min(first + m_VertexChunkSize, mesh.vertices.size()) };
+			for (size_t vertexIndex{ first }; vertexIndex < end; ++vertexIndex)
+			{
+				mesh.vertices_out[vertexIndex] = TransformVertex(mesh, worldViewProjectionMatrix, mesh.vertices[vertexIndex]);
+			}
+		});
+}
+
+void Renderer::VertexTransformationFunction(Mesh& mesh, const FrameVector<uint32_t>& vertexIndices)
+{
+	Matrix worldViewProjectionMatrix{ mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+	mesh.vertices_out = FrameVector<Vertex_Out>{ m_FrameArena };
+	mesh.vertices_out.resize(mesh.vertices.size());
+
+	// Every listed vertex is there once, so chunks can be filled in parallel without locking
+	const uint32_t nrChunks{ static_cast<uint32_t>((vertexIndices.size() + m_VertexChunkSize - 1) / m_VertexChunkSize) };
+	m_pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIndex)
+		{
+			const size_t first{ chunkIndex * m_VertexChunkSize };
+			const size_t end{ std::min(first + m_VertexChunkSize, vertexIndices.size()) };
+			for (size_t listIndex{ first }; listIndex < end; ++listIndex)
+			{
+				const uint32_t vertexIndex{ vertexIndices[listIndex] };
+				mesh.vertices_out[vertexIndex] = TransformVertex(mesh, worldViewProjectionMatrix, mesh.vertices[vertexIndex]);
+			}
+		});
+}
+
+Vertex_Out Renderer::TransformVertex(const Mesh& mesh, const Matrix& worldViewProjectionMatrix, const Vertex& v) const
+{
+	Vertex_Out vertex_out{ Vector4{}, v.color, v.uv, v.normal, v.tangent };
+
+	vertex_out.position = worldViewProjectionMatrix.TransformPoint({ v.position, 1.0f });
+	//From the camera to the vertex in world space, left unnormalized so it still interpolates linearly
+	vertex_out.viewDirection = mesh.worldMatrix.TransformPoint(v.position) - m_Camera.origin;
+
+	vertex_out.normal = mesh.worldMatrix.TransformVector(v.normal);
+	vertex_out.tangent = mesh.worldMatrix.TransformVector(v.tangent);
+
+	const float invVw{ 1 / vertex_out.position.w };
+	vertex_out.position.x *= invVw;
+	vertex_out.position.y *= invVw;
+	vertex_out.position.z *= invVw;
+	return vertex_out;
+}
+
+void Renderer::TransformMeshPositions(const Mesh& mesh, FrameVector<Vector2>& screenSpace)
+{
+	// Clipped vertices get added to the back, leave some room so that rarely means a reallocation
+	const size_t nrVertices{ mesh.streams.positionX.size() };
+	const size_t capacity{ nrVertices + nrVertices / 8 };
+
+	screenSpace.reserve(capacity);
+	screenSpace.resize(nrVertices);
+	m_VertexDepths = FrameVector<float>{ m_FrameArena };
+	m_VertexDepths.reserve(capacity);
+	m_VertexDepths.resize(nrVertices);
+	m_VertexInvW = FrameVector<float>{ m_FrameArena };
+	m_VertexInvW.reserve(capacity);
+	m_VertexInvW.resize(nrVertices);
+	m_ClippedUVs = FrameVector<Vector2>{ m_FrameArena };
+	m_ClipCodes = FrameVector<uint16_t>{ m_FrameArena };
+	m_ClipCodes.resize(nrVertices);
+
+	m_VertexTarget.pScreenPositions = screenSpace.data();
+	m_VertexTarget.pDepths = m_VertexDepths.data();
+	m_VertexTarget.pInvW = m_VertexInvW.data();
+	m_VertexTarget.pClipCodes = m_ClipCodes.data();
+	m_VertexTarget.width = static_cast<float>(m_Width);
+	m_VertexTarget.height = static_cast<float>(m_Height);
+
+	m_WorldViewProjection = mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+	if (m_UseVertexCache)
+	{
+		return;
+	}
+
+	// Fixed size chunks write disjoint slices of the outputs, so the result doesn't depend on which thread takes which chunk
+	const uint32_t nrChunks{ static_cast<uint32_t>((nrVertices + m_VertexChunkSize - 1) / m_VertexChunkSize) };
+	m_pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIndex)
+		{
+			const size_t first{ chunkIndex * m_VertexChunkSize };
+			m_pTransformKernel(m_WorldViewProjection, mesh.streams, first, std::min(m_VertexChunkSize, nrVertices - first), m_VertexTarget);
+		});
+}
+
+Vector2 Renderer::NdcToScreen(const Vector4& ndcPosition) const
+{
+	// Formula from slides
+	// NDC --> Screenspace
+	return { (ndcPosition.x + 1) / 2.0f * m_Width, (1.0f - ndcPosition.y) / 2.0f * m_Height };
+}
+
+void Renderer::BinMeshTriangles(Mesh& mesh, FrameVector<Vector2>& screenSpace)
+{
+	int indexStep{};
+	int endIndex{};
+	switch (mesh.primitiveTopology)
+	{
+	case PrimitiveTopology::TriangleList:
+		indexStep = 3;
+		endIndex = static_cast<int>(mesh.indices.size());
+		break;
+	case PrimitiveTopology::TriangleStrip:
+		indexStep = 1;
+		endIndex = static_cast<int>(mesh.indices.size()) - 2;
+		break;
+	default:
+		std::cout << "no primitive\n";
+		return;
+	}
+
+	const int firstSetup{ static_cast<int>(m_TriangleSetups.size()) };
+	m_TriangleSetups.reserve(firstSetup + std::max(endIndex / indexStep, 0));
+	if (m_BuildAttributes)
+	{
+		m_TriangleAttributes.reserve(m_TriangleSetups.capacity());
+	}
+
+	if (m_UseVertexCache)
+	{
+		TransformVertexCacheMisses(mesh, indexStep, endIndex);
+	}
+
+	for (int index{ 0 }; index < endIndex; index += indexStep)
+	{
+		uint32_t vertexIndices[3]{};
+		GetTriangleIndices(mesh, index, vertexIndices);
+
+		// All three outside the same frustum plane means the whole triangle is
+		const uint16_t clipCodesAll{ static_cast<uint16_t>(m_ClipCodes[vertexIndices[0]] & m_ClipCodes[vertexIndices[1]] & m_ClipCodes[vertexIndices[2]]) };
+		if (clipCodesAll & VertexKernels::Frustum)
+		{
+			++m_CullStats.outsideFrustum;
+			continue;
+		}
+
+		const uint16_t clipCodesAny{ static_cast<uint16_t>(m_ClipCodes[vertexIndices[0]] | m_ClipCodes[vertexIndices[1]] | m_ClipCodes[vertexIndices[2]]) };
+		if (clipCodesAny & VertexKernels::NeedsClip)
+		{
+			ClipTriangle(mesh, screenSpace, vertexIndices, clipCodesAny);
+			continue;
+		}
+
+		AddTriangle(mesh, screenSpace, vertexIndices);
+	}
+
+	FillTileBins(firstSetup);
+}
+
+void Renderer::GetTriangleIndices(const Mesh& mesh, int index, uint32_t(&vertexIndices)[3])
 {
-	meshes_out.reserve(meshes_in.size());
-	for (const Mesh& mesh : meshes_in)
+	// Every odd triangle of a strip has its winding flipped
+	const bool swapVertices{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip && index % 2 == 1 };
+	vertexIndices[0] = mesh.indices[index + (2 * swapVertices)];
+	vertexIndices[1] = mesh.indices[index + 1];
+	vertexIndices[2] = mesh.indices[index + (!swapVertices * 2)];
+}
+
+void Renderer::TransformVertexCacheMisses(Mesh& mesh, int indexStep, int endIndex)
+{
+	m_VertexCache.Clear();
+	m_VertexCache.ResetStats();
+
+	// Which vertices miss only depends on the indices, so the cache can run ahead of triangle assembly
+	// A vertex that misses again after it got evicted still has its outputs in its slot, it only counts in the stats
+	const size_t nrVertices{ mesh.vertices.size() };
+	FrameVector<uint8_t> isTransformed{ m_FrameArena };
+	isTransformed.resize(nrVertices);
+	m_VertexCacheMisses = FrameVector<uint32_t>{ m_FrameArena };
+	m_VertexCacheMisses.reserve(nrVertices);
+	for (int index{ 0 }; index < endIndex; index += indexStep)
 	{
-		std::vector<Vertex> vertices_out;
-		VertexTransformationFunction(mesh.vertices, vertices_out);
-		meshes_out.emplace_back
-		(
-			Mesh
+		uint32_t vertexIndices[3]{};
+		GetTriangleIndices(mesh, index, vertexIndices);
+		for (const uint32_t vertexIndex : vertexIndices)
+		{
+			if (!m_VertexCache.Lookup(vertexIndex) && !isTransformed[vertexIndex])
 			{
-					vertices_out,
-					mesh.indices,
-					mesh.primitiveTopology
+				isTransformed[vertexIndex] = 1;
+				m_VertexCacheMisses.push_back(vertexIndex);
 			}
-		);
+		}
+	}
+
+	// Every miss is listed once, so fixed size chunks write disjoint slots of the outputs
+	const size_t nrMisses{ m_VertexCacheMisses.size() };
+	const uint32_t nrChunks{ static_cast<uint32_t>((nrMisses + m_VertexChunkSize - 1) / m_VertexChunkSize) };
+	m_pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIndex)
+		{
+			const size_t first{ chunkIndex * m_VertexChunkSize };
+			m_pIndexedTransformKernel(m_WorldViewProjection, mesh.streams, m_VertexCacheMisses.data() + first, std::min(m_VertexChunkSize, nrMisses - first), m_VertexTarget);
+		});
+
+	if (m_BuildAttributes)
+	{
+		VertexTransformationFunction(mesh, m_VertexCacheMisses);
 	}
 }
 
-void Renderer::VertexTransformationFunction(Mesh& mesh)
+void Renderer::AddTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, uint32_t(&vertexIndices)[3])
 {
-	Matrix worldViewProjectionMatrix{ mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
-	mesh.vertices_out.clear();
-	mesh.vertices_out.reserve(mesh.vertices.size());
+	if (CullTriangle(mesh, screenSpace, vertexIndices))
+	{
+		return;
+	}
+
+	TriangleSetup triangle{};
+	if (!SetupTriangle(mesh, screenSpace, vertexIndices, triangle))
+	{
+		++m_CullStats.offScreen;
+		return;
+	}
 
-	for (const Vertex& v : mesh.vertices)
+	triangle.id = static_cast<uint32_t>(m_TriangleSetups.size());
+	m_TriangleSetups.push_back(triangle);
+	if (m_BuildAttributes)
 	{
-		Vertex_Out vertex_out{ Vector4{}, v.color, v.uv, v.normal, v.tangent };
+		m_TriangleAttributes.push_back(SetupAttributes(mesh, triangle));
+	}
+}
+
+void Renderer::FillTileBins(int firstSetup)
+{
+	const int nrTiles{ m_NrTilesX * m_NrTilesY };
+	const auto forEachTile{ [this](const TriangleSetup& triangle, const auto& function)
+		{
+			for (int tileY{ triangle.boundTopLeft.y / m_TileSize }; tileY <= (triangle.boundBotRight.y - 1) / m_TileSize; ++tileY)
+			{
+				for (int tileX{ triangle.boundTopLeft.x / m_TileSize }; tileX <= (triangle.boundBotRight.x - 1) / m_TileSize; ++tileX)
+				{
+					function(tileX + tileY * m_NrTilesX);
+				}
+			}
+		} };
+
+	// Count first so every bin gets an exact slice of one array, no bin ever has to grow
+	m_TileBinOffsets = FrameVector<int>{ m_FrameArena };
+	m_TileBinOffsets.resize(nrTiles + 1);
+	for (int setupIndex{ firstSetup }; setupIndex < static_cast<int>(m_TriangleSetups.size()); ++setupIndex)
+	{
+		forEachTile(m_TriangleSetups[setupIndex], [this](int tileIndex) { ++m_TileBinOffsets[tileIndex + 1]; });
+	}
+
+	for (int tileIndex{ 0 }; tileIndex < nrTiles; ++tileIndex)
+	{
+		m_TileBinOffsets[tileIndex + 1] += m_TileBinOffsets[tileIndex];
+	}
+
+	// Triangles get added in index order, so every tile still draws them in the same order as before
+	FrameVector<int> binEnds{ m_TileBinOffsets.begin(), m_TileBinOffsets.end() - 1, ArenaAllocator<int>{ m_FrameArena } };
+	m_BinnedTriangles = FrameVector<int>{ m_FrameArena };
+	m_BinnedTriangles.resize(m_TileBinOffsets[nrTiles]);
+	for (int setupIndex{ firstSetup }; setupIndex < static_cast<int>(m_TriangleSetups.size()); ++setupIndex)
+	{
+		forEachTile(m_TriangleSetups[setupIndex], [&](int tileIndex) { m_BinnedTriangles[binEnds[tileIndex]++] = setupIndex; });
+	}
+}
+
+void Renderer::ClipTriangle(Mesh& mesh, FrameVector<Vector2>& screenSpace, const uint32_t(&vertexIndices)[3], uint16_t clipCodes)
+{
+	// Sutherland-Hodgman in clip space, where all attributes are still linear, every plane adds at most one vertex
+	constexpr int maxNrVertices{ 3 + 5 };
+	Vertex_Out polygons[2][maxNrVertices]{};
+	int nrVertices{ 3 };
+	int current{ 0 };
+
+	// Attributes only come along when this frame built vertices_out
+	const bool hasAttributes{ !mesh.vertices_out.empty() };
+	for (int i{ 0 }; i < 3; ++i)
+	{
+		const uint32_t vertexIndex{ vertexIndices[i] };
+		if (hasAttributes)
+		{
+			polygons[current][i] = mesh.vertices_out[vertexIndex];
+		}
+		else
+		{
+			polygons[current][i].uv = GetVertexUV(mesh, vertexIndex);
+		}
+		polygons[current][i].position = m_WorldViewProjection.TransformPoint(mesh.streams.positionX[vertexIndex], mesh.streams.positionY[vertexIndex], mesh.streams.positionZ[vertexIndex], 1.f);
+	}
+
+	using namespace VertexKernels;
+	for (const ClipCode plane : { Near, GuardLeft, GuardRight, GuardBottom, GuardTop })
+	{
+		if (!(clipCodes & plane))
+		{
+			continue;
+		}
+
+		// Signed distance to the plane, positive on the side that's kept
+		const auto distance{ [plane](const Vector4& position)
+			{
+				switch (plane)
+				{
+				case Near:			return position.z;
+				case GuardLeft:		return GuardBand * position.w + position.x;
+				case GuardRight:	return GuardBand * position.w - position.x;
+				case GuardBottom:	return GuardBand * position.w + position.y;
+				default:			return GuardBand * position.w - position.y;
+				}
+			} };
 
-		vertex_out.position = worldViewProjectionMatrix.TransformPoint({ v.position, 1.0f });
-		vertex_out.viewDirection = Vector3{ vertex_out.position.x, vertex_out.position.y, vertex_out.position.z }.Normalized();
+		const Vertex_Out* pIn{ polygons[current] };
+		Vertex_Out* pOut{ polygons[1 - current] };
+		int nrOut{ 0 };
 
-		vertex_out.normal = mesh.worldMatrix.TransformVector(v.normal);
-		vertex_out.tangent = mesh.worldMatrix.TransformVector(v.tangent);
+		for (int i{ 0 }; i < nrVertices; ++i)
+		{
+			const Vertex_Out& from{ pIn[i] };
+			const Vertex_Out& to{ pIn[(i + 1) % nrVertices] };
+			const float fromDistance{ distance(from.position) };
+			const float toDistance{ distance(to.position) };
 
+			if (fromDistance >= 0.f)
+			{
+				pOut[nrOut++] = from;
+			}
+
+			if ((fromDistance >= 0.f) != (toDistance >= 0.f))
+			{
+				const float t{ fromDistance / (fromDistance - toDistance) };
+
+				Vertex_Out& clipped{ pOut[nrOut++] };
+				clipped.position = from.position + (to.position - from.position) * t;
+				clipped.color = ColorRGB::Lerp(from.color, to.color, t);
+				clipped.uv = from.uv + (to.uv - from.uv) * t;
+				clipped.normal = from.normal + (to.normal - from.normal) * t;
+				clipped.tangent = from.tangent + (to.tangent - from.tangent) * t;
+				clipped.viewDirection = from.viewDirection + (to.viewDirection - from.viewDirection) * t;
+			}
+		}
+
+		nrVertices = nrOut;
+		current = 1 - current;
+
+		if (nrVertices < 3)
+		{
+			++m_CullStats.outsideFrustum;
+			return;
+		}
+	}
+
+	// The clipped polygon becomes new vertices that get binned as a fan, which keeps the winding
+	const uint32_t firstIndex{ static_cast<uint32_t>(screenSpace.size()) };
+	for (int i{ 0 }; i < nrVertices; ++i)
+	{
+		Vertex_Out vertex_out{ polygons[current][i] };
 
 		const float invVw{ 1 / vertex_out.position.w };
 		vertex_out.position.x *= invVw;
 		vertex_out.position.y *= invVw;
 		vertex_out.position.z *= invVw;
 
-		// emplace back because we made vOut just to store in this vector
-		mesh.vertices_out.emplace_back(vertex_out);
+		screenSpace.emplace_back(NdcToScreen(vertex_out.position));
+		m_VertexDepths.emplace_back(vertex_out.position.z);
+		m_VertexInvW.emplace_back(invVw);
+		m_ClippedUVs.emplace_back(vertex_out.uv);
+		if (hasAttributes)
+		{
+			mesh.vertices_out.emplace_back(vertex_out);
+		}
+	}
+
+	for (int i{ 1 }; i < nrVertices - 1; ++i)
+	{
+		uint32_t fanIndices[3]{ firstIndex, firstIndex + i, firstIndex + i + 1 };
+		AddTriangle(mesh, screenSpace, fanIndices);
 	}
 }
 
-void dae::Renderer::RenderMeshTriangle(const Mesh& mesh, const std::vector<Vector2>& screenSpace, int vertexIndex, bool swapVertices)
+bool Renderer::CullTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, uint32_t(&vertexIndices)[3])
 {
-	const size_t vertexIndex0{ mesh.indices[vertexIndex + (2 * swapVertices)] };
-	const size_t vertexIndex1{ mesh.indices[vertexIndex + 1] };
-	const size_t vertexIndex2{ mesh.indices[vertexIndex + (!swapVertices * 2)] };
+	if (vertexIndices[0] == vertexIndices[1] || vertexIndices[1] == vertexIndices[2] || vertexIndices[2] == vertexIndices[0])
+	{
+		++m_CullStats.zeroArea;
+		return true;
+	}
+
+	const Vector2& vertex0{ screenSpace[vertexIndices[0]] };
+	const Vector2& vertex1{ screenSpace[vertexIndices[1]] };
+	const Vector2& vertex2{ screenSpace[vertexIndices[2]] };
 
-	if (vertexIndex0 == vertexIndex1 || vertexIndex1 == vertexIndex2 || vertexIndex2 == vertexIndex0)
+	const float signedArea{ Vector2::Cross(vertex1 - vertex0, vertex2 - vertex0) };
+	if (signedArea == 0.f)
 	{
-		return;
+		++m_CullStats.zeroArea;
+		return true;
+	}
+
+	const bool isFrontFace{ signedArea > 0.f };
+	if ((mesh.cullMode == CullMode::Back && !isFrontFace) || (mesh.cullMode == CullMode::Front && isFrontFace))
+	{
+		++m_CullStats.facing;
+		return true;
 	}
 
+	// Pixels are sampled on whole coordinates, a bounding box without any of those can't cover a single pixel
+	const Vector2 boundMin{ Vector2::Min(vertex0, Vector2::Min(vertex1, vertex2)) };
+	const Vector2 boundMax{ Vector2::Max(vertex0, Vector2::Max(vertex1, vertex2)) };
+	if (std::ceil(boundMin.x) > std::floor(boundMax.x) || std::ceil(boundMin.y) > std::floor(boundMax.y))
+	{
+		++m_CullStats.noSample;
+		return true;
+	}
+
+	// The rasterizer only fills triangles with a positive area, back faces that are kept get their winding turned around
+	if (!isFrontFace)
+	{
+		std::swap(vertexIndices[1], vertexIndices[2]);
+	}
+	return false;
+}
+
+bool Renderer::SetupTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, const uint32_t(&vertexIndices)[3], TriangleSetup& triangle) const
+{
+	const uint32_t vertexIndex0{ vertexIndices[0] };
+	const uint32_t vertexIndex1{ vertexIndices[1] };
+	const uint32_t vertexIndex2{ vertexIndices[2] };
+
 	const Vector2 vertex0{ screenSpace[vertexIndex0] };
 	const Vector2 vertex1{ screenSpace[vertexIndex1] };
 	const Vector2 vertex2{ screenSpace[vertexIndex2] };
@@ -195,71 +663,283 @@ void dae::Renderer::RenderMeshTriangle(const Mesh& mesh, const std::vector<Vecto
 		boundBotRight	+= marginVect;
 	}
 
-	boundTopLeft.x	= Clamp(boundTopLeft.x,  0.f, static_cast<float>(m_Width));
-	boundTopLeft.y	= Clamp(boundTopLeft.y,  0.f, static_cast<float>(m_Height));
-	boundBotRight.x = Clamp(boundBotRight.x, 0.f, static_cast<float>(m_Width));
-	boundBotRight.y = Clamp(boundBotRight.y, 0.f, static_cast<float>(m_Height));
+	triangle.boundTopLeft.x		= static_cast<int>(Clamp(boundTopLeft.x,  0.f, static_cast<float>(m_Width)));
+	triangle.boundTopLeft.y		= static_cast<int>(Clamp(boundTopLeft.y,  0.f, static_cast<float>(m_Height)));
+	triangle.boundBotRight.x	= static_cast<int>(Clamp(boundBotRight.x, 0.f, static_cast<float>(m_Width)));
+	triangle.boundBotRight.y	= static_cast<int>(Clamp(boundBotRight.y, 0.f, static_cast<float>(m_Height)));
+
+	if (triangle.boundTopLeft.x >= triangle.boundBotRight.x || triangle.boundTopLeft.y >= triangle.boundBotRight.y)
+	{
+		return false;
+	}
+
+	triangle.vertexIndices[0] = vertexIndex0;
+	triangle.vertexIndices[1] = vertexIndex1;
+	triangle.vertexIndices[2] = vertexIndex2;
+
+	// Edge function of the edge from 'from' to 'to' is Cross(to - from, pixel - from)
+	const Vector2* edgeVertices[3][2]{ { &vertex1, &vertex2 }, { &vertex2, &vertex0 }, { &vertex0, &vertex1 } };
+	for (int edge{ 0 }; edge < 3; ++edge)
+	{
+		const Vector2& from{ *edgeVertices[edge][0] };
+		const Vector2& to{ *edgeVertices[edge][1] };
+
+		triangle.edgeStepX[edge] = from.y - to.y;
+		triangle.edgeStepY[edge] = to.x - from.x;
+		triangle.edgeOffset[edge] = -(triangle.edgeStepX[edge] * from.x + triangle.edgeStepY[edge] * from.y);
+	}
+
+	triangle.invArea = 1.f / Vector2::Cross(vertex1 - vertex0, vertex2 - vertex0);
+
+	triangle.invDepth[0] = 1.f / m_VertexDepths[vertexIndex0];
+	triangle.invDepth[1] = 1.f / m_VertexDepths[vertexIndex1];
+	triangle.invDepth[2] = 1.f / m_VertexDepths[vertexIndex2];
+
+	triangle.minDepth = std::min(m_VertexDepths[vertexIndex0], std::min(m_VertexDepths[vertexIndex1], m_VertexDepths[vertexIndex2]));
+
+	const float invW0{ m_VertexInvW[vertexIndex0] };
+	const float invW1{ m_VertexInvW[vertexIndex1] };
+	const float invW2{ m_VertexInvW[vertexIndex2] };
+	const Vector2 uv0{ GetVertexUV(mesh, vertexIndex0) };
+	const Vector2 uv1{ GetVertexUV(mesh, vertexIndex1) };
+	const Vector2 uv2{ GetVertexUV(mesh, vertexIndex2) };
+
+	triangle.invW = GetAttributePlane(triangle, invW0, invW1, invW2);
+	triangle.uOverW = GetAttributePlane(triangle, uv0.x * invW0, uv1.x * invW1, uv2.x * invW2);
+	triangle.vOverW = GetAttributePlane(triangle, uv0.y * invW0, uv1.y * invW1, uv2.y * invW2);
+
+	return true;
+}
+
+ScreenPlane Renderer::GetAttributePlane(const TriangleSetup& triangle, float value0, float value1, float value2)
+{
+	// A vertex attribute a interpolates as sum(a[i] * E[i] / area), which is a plane in screen space
+	const float values[3]{ value0, value1, value2 };
+	ScreenPlane plane{};
+	for (int vertex{ 0 }; vertex < 3; ++vertex)
+	{
+		plane.stepX += values[vertex] * triangle.edgeStepX[vertex];
+		plane.stepY += values[vertex] * triangle.edgeStepY[vertex];
+		plane.offset += values[vertex] * triangle.edgeOffset[vertex];
+	}
+	plane.stepX *= triangle.invArea;
+	plane.stepY *= triangle.invArea;
+	plane.offset *= triangle.invArea;
+	return plane;
+}
+
+AttributePlanes Renderer::SetupAttributes(const Mesh& mesh, const TriangleSetup& triangle) const
+{
+	// Over w like uv, so the shaders get them perspective correct
+	float invW[3]{};
+	const Vertex_Out* pVertices[3]{};
+	for (int vertex{ 0 }; vertex < 3; ++vertex)
+	{
+		invW[vertex] = m_VertexInvW[triangle.vertexIndices[vertex]];
+		pVertices[vertex] = &mesh.vertices_out[triangle.vertexIndices[vertex]];
+	}
+
+	AttributePlanes attributes{};
+	attributes.colorOverW[0] = GetAttributePlane(triangle, pVertices[0]->color.r * invW[0], pVertices[1]->color.r * invW[1], pVertices[2]->color.r * invW[2]);
+	attributes.colorOverW[1] = GetAttributePlane(triangle, pVertices[0]->color.g * invW[0], pVertices[1]->color.g * invW[1], pVertices[2]->color.g * invW[2]);
+	attributes.colorOverW[2] = GetAttributePlane(triangle, pVertices[0]->color.b * invW[0], pVertices[1]->color.b * invW[1], pVertices[2]->color.b * invW[2]);
+	for (int axis{ 0 }; axis < 3; ++axis)
+	{
+		attributes.normalOverW[axis] = GetAttributePlane(triangle, pVertices[0]->normal[axis] * invW[0], pVertices[1]->normal[axis] * invW[1], pVertices[2]->normal[axis] * invW[2]);
+		attributes.tangentOverW[axis] = GetAttributePlane(triangle, pVertices[0]->tangent[axis] * invW[0], pVertices[1]->tangent[axis] * invW[1], pVertices[2]->tangent[axis] * invW[2]);
+		attributes.viewDirectionOverW[axis] = GetAttributePlane(triangle, pVertices[0]->viewDirection[axis] * invW[0], pVertices[1]->viewDirection[axis] * invW[1], pVertices[2]->viewDirection[axis] * invW[2]);
+	}
+	return attributes;
+}
+
+Vector2 Renderer::GetVertexUV(const Mesh& mesh, uint32_t vertexIndex) const
+{
+	const uint32_t nrVertices{ static_cast<uint32_t>(mesh.vertices.size()) };
+	return vertexIndex < nrVertices ? mesh.vertices[vertexIndex].uv : m_ClippedUVs[vertexIndex - nrVertices];
+}
+
+PixelShaders::ShadeContext Renderer::GetShadeContext() const
+{
+	return { &m_RasterTarget, m_TriangleAttributes.data(), m_pMaterial, m_TextureFilter, m_InstructionSet };
+}
 
-	const int startX{	static_cast<int>(boundTopLeft.x)  };
-	const int endX{		static_cast<int>(boundBotRight.x)  };
-	const int startY{	static_cast<int>(boundTopLeft.y) };
-	const int endY{		static_cast<int>(boundBotRight.y) };
+template<PixelShaders::PixelShader Shader>
+void Renderer::RenderTile(int tileIndex)
+{
+	const Int2 tileTopLeft{ (tileIndex % m_NrTilesX) * m_TileSize, (tileIndex / m_NrTilesX) * m_TileSize };
+	const Int2 tileBotRight{ std::min(tileTopLeft.x + m_TileSize, m_Width), std::min(tileTopLeft.y + m_TileSize, m_Height) };
 
-	// For each pixel
-	for (int px{ startX }; px < endX; ++px)
+	Shader shader{ GetShadeContext() };
+	for (int binIndex{ m_TileBinOffsets[tileIndex] }; binIndex < m_TileBinOffsets[tileIndex + 1]; ++binIndex)
 	{
-		for (int py{ startY }; py < endY; ++py)
+		const TriangleSetup& triangle{ m_TriangleSetups[m_BinnedTriangles[binIndex]] };
+
+		// Hi-Z: everything in this tile is already closer than the closest point of the triangle
+		if (triangle.minDepth > m_HiZTileMaxDepth[tileIndex])
 		{
-			const Vector2 currentPixel{ static_cast<float>(px), static_cast<float>(py) };
-			const int pixelIdx{ px + py * m_Width };
+			continue;
+		}
 
-			const bool hitTriangle{ Utils::IsInTriangel(currentPixel,vertex0,vertex1,vertex2) };
-			if (hitTriangle)
-			{
-				ColorRGB finalColor{};
-				float weight0, weight1, weight2;
-				weight0 = Vector2::Cross((currentPixel - vertex1), (vertex1 - vertex2));
-				weight1 = Vector2::Cross((currentPixel - vertex2), (vertex2 - vertex0));
-				weight2 = Vector2::Cross((currentPixel - vertex0), (vertex0 - vertex1));
+		float loweredMaxDepth{};
+		if constexpr (Shader::HasRasterKernel)
+		{
+			loweredMaxDepth = m_pTriangleKernel ? m_pTriangleKernel(triangle, m_RasterTarget, tileTopLeft, tileBotRight) : RenderMeshTriangle(triangle, tileTopLeft, tileBotRight, shader);
+		}
+		else
+		{
+			loweredMaxDepth = RenderMeshTriangle(triangle, tileTopLeft, tileBotRight, shader);
+		}
+
+		// The tile max only moves when one of the blocks holding it went down
+		if (loweredMaxDepth >= m_HiZTileMaxDepth[tileIndex])
+		{
+			UpdateTileMaxDepth(tileIndex, tileTopLeft, tileBotRight);
+		}
+	}
+	shader.Flush();
+}
+
+void Renderer::UpdateTileMaxDepth(int tileIndex, const Int2& tileTopLeft, const Int2& tileBotRight)
+{
+	const int blockSize{ RasterKernels::HiZBlockSize };
 
-				const float totalTriangleArea{ Vector2::Cross(vertex1 - vertex0,vertex2 - vertex0) };
-				const float invTotalTriangleArea{ 1 / totalTriangleArea };
-				weight0 *= invTotalTriangleArea;
-				weight1 *= invTotalTriangleArea;
-				weight2 *= invTotalTriangleArea;
+	float tileMaxDepth{ 0.f };
+	for (int blockY{ tileTopLeft.y / blockSize }; blockY < (tileBotRight.y + blockSize - 1) / blockSize; ++blockY)
+	{
+		for (int blockX{ tileTopLeft.x / blockSize }; blockX < (tileBotRight.x + blockSize - 1) / blockSize; ++blockX)
+		{
+			tileMaxDepth = std::max(tileMaxDepth, m_HiZBlockMaxDepth[blockX + blockY * m_HiZBlockStride]);
+		}
+	}
+	m_HiZTileMaxDepth[tileIndex] = tileMaxDepth;
+}
 
-				const float depth0{ mesh.vertices_out[vertexIndex0].position.z };
-				const float depth1{ mesh.vertices_out[vertexIndex1].position.z };
-				const float depth2{ mesh.vertices_out[vertexIndex2].position.z };
+template<PixelShaders::PixelShader Shader>
+float Renderer::RenderMeshTriangle(const TriangleSetup& triangle, const Int2& tileTopLeft, const Int2& tileBotRight, Shader& shader)
+{
+	// Only the part of the triangle inside this tile
+	const int startX{	std::max(triangle.boundTopLeft.x, tileTopLeft.x) };
+	const int endX{		std::min(triangle.boundBotRight.x, tileBotRight.x) };
+	const int startY{	std::max(triangle.boundTopLeft.y, tileTopLeft.y) };
+	const int endY{		std::min(triangle.boundBotRight.y, tileBotRight.y) };
+	const int blockSize{ RasterKernels::HiZBlockSize };
+
+	// Edge functions are linear: evaluate them once per row and step down with constant adds
+	// Columns are offset from the same 8 pixel aligned origin the SIMD kernels use, so every path gives the exact same floats
+	const int spanOriginX{ startX & ~7 };
+	float rowEdge0{ triangle.edgeStepX[0] * spanOriginX + triangle.edgeStepY[0] * startY + triangle.edgeOffset[0] };
+	float rowEdge1{ triangle.edgeStepX[1] * spanOriginX + triangle.edgeStepY[1] * startY + triangle.edgeOffset[1] };
+	float rowEdge2{ triangle.edgeStepX[2] * spanOriginX + triangle.edgeStepY[2] * startY + triangle.edgeOffset[2] };
+
+	float loweredMaxDepth{ 0.f };
+
+	// For each row of Hi-Z blocks
+	for (int blockY{ startY & ~(blockSize - 1) }; blockY < endY; blockY += blockSize)
+	{
+		const int rowStart{ std::max(blockY, startY) };
+		const int nrRows{ std::min(blockY + blockSize, endY) - rowStart };
 
-				const float interpolatedDepth = 1.f / ( ((1.f / depth0) * weight0) + ((1.f / depth1) * weight1) + ((1.f / depth2) * weight2));
+		float blockRowEdge0[blockSize], blockRowEdge1[blockSize], blockRowEdge2[blockSize];
+		for (int row{ 0 }; row < nrRows; ++row)
+		{
+			blockRowEdge0[row] = rowEdge0;
+			blockRowEdge1[row] = rowEdge1;
+			blockRowEdge2[row] = rowEdge2;
 
-				if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth || interpolatedDepth < 0.f || interpolatedDepth > 1.f)
+			rowEdge0 += triangle.edgeStepY[0];
+			rowEdge1 += triangle.edgeStepY[1];
+			rowEdge2 += triangle.edgeStepY[2];
+		}
+
+		// For each block in that row
+		for (int blockX{ spanOriginX }; blockX < endX; blockX += blockSize)
+		{
+			// Hi-Z: the whole block already holds something closer than the closest point of the triangle
+			if (triangle.minDepth > m_HiZBlockMaxDepth[blockX / blockSize + (blockY / blockSize) * m_HiZBlockStride])
+			{
+				continue;
+			}
+			float* pRowMaxDepths{ RasterKernels::GetRowMaxDepths(m_RasterTarget, blockX, blockY) };
+
+			bool wroteBlock{ false };
+
+			// For each pixel, row by row so the buffers are walked contiguously
+			for (int row{ 0 }; row < nrRows; ++row)
+			{
+				const int py{ rowStart + row };
+				bool wroteRow{ false };
+				for (int px{ std::max(blockX, startX) }; px < std::min(blockX + blockSize, endX); ++px)
 				{
-					continue;
+					const int pixelIdx{ px + py * m_Stride };
+
+					const float columnOffset{ static_cast<float>(px - spanOriginX) };
+					const float edge0{ blockRowEdge0[row] + triangle.edgeStepX[0] * columnOffset };
+					const float edge1{ blockRowEdge1[row] + triangle.edgeStepX[1] * columnOffset };
+					const float edge2{ blockRowEdge2[row] + triangle.edgeStepX[2] * columnOffset };
+
+					const bool hitTriangle{ edge0 >= 0.f && edge1 >= 0.f && edge2 >= 0.f };
+					if (hitTriangle)
+					{
+						const float weight0{ edge0 * triangle.invArea };
+						const float weight1{ edge1 * triangle.invArea };
+						const float weight2{ edge2 * triangle.invArea };
+
+						// Rounding can take the interpolated depth below every vertex, clamped it never beats what Hi-Z rejected on
+						// The compare is the one maxps does, so the SIMD kernels clamp the same
+						const float unclampedDepth{ 1.f / ((triangle.invDepth[0] * weight0) + (triangle.invDepth[1] * weight1) + (triangle.invDepth[2] * weight2)) };
+						const float interpolatedDepth{ unclampedDepth > triangle.minDepth ? unclampedDepth : triangle.minDepth };
+
+						if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth || interpolatedDepth < 0.f || interpolatedDepth > 1.f)
+						{
+							continue;
+						}
+
+						m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
+						wroteRow = true;
+
+						shader.Shade(triangle, px, py, pixelIdx, interpolatedDepth);
+					}
 				}
 
-				m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
-				
-				//finalColor = { weight0 * mesh.vertices[vertexIndex0].color + weight1 * mesh.vertices[vertexIndex1].color + weight2 * mesh.vertices[vertexIndex2].color };
-				
-				//Vector2 UVinterpolated{ (((mesh.vertices[vertexIndex0].uv / depth0) * weight0) + ((mesh.vertices[vertexIndex1].uv / depth1) * weight1) + ((mesh.vertices[vertexIndex2].uv / depth2) * weight2)) * interpolatedDepth };
-				//finalColor = m_pTexture->Sample(UVinterpolated);
+				if (wroteRow)
+				{
+					pRowMaxDepths[py - blockY] = RasterKernels::ComputeRowMaxDepth(m_RasterTarget, blockX, py);
+					wroteBlock = true;
+				}
+			}
 
+			if (wroteBlock)
+			{
+				loweredMaxDepth = std::max(loweredMaxDepth, RasterKernels::UpdateBlockMaxDepth(m_RasterTarget, blockX, blockY));
+			}
+		}
+	}
 
-				const float depthCol{ Remap(interpolatedDepth,0.985f,1.f) };
-				finalColor = { depthCol,depthCol,depthCol };
+	return loweredMaxDepth;
+}
 
-				//Update Color in Buffer
-				finalColor.MaxToOne();
+template<PixelShaders::PixelShader Shader>
+void Renderer::ShadeVisibleTile(int tileIndex)
+{
+	const Int2 tileTopLeft{ (tileIndex % m_NrTilesX) * m_TileSize, (tileIndex / m_NrTilesX) * m_TileSize };
+	const Int2 tileBotRight{ std::min(tileTopLeft.x + m_TileSize, m_Width), std::min(tileTopLeft.y + m_TileSize, m_Height) };
 
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
+	Shader shader{ GetShadeContext() };
+	for (int py{ tileTopLeft.y }; py < tileBotRight.y; ++py)
+	{
+		for (int px{ tileTopLeft.x }; px < tileBotRight.x; ++px)
+		{
+			// Depth only ever gets written inside [0, 1], pixels still at the cleared value show the background
+			const int pixelIdx{ px + py * m_Stride };
+			if (m_pDepthBufferPixels[pixelIdx] == FLT_MAX)
+			{
+				continue;
 			}
+
+			shader.Shade(m_TriangleSetups[m_pVisibilityBufferPixels[pixelIdx]], px, py, pixelIdx, m_pDepthBufferPixels[pixelIdx]);
 		}
 	}
+	shader.Flush();
 }
 
 bool Renderer::SaveBufferToImage() const
@@ -267,6 +947,46 @@ bool Renderer::SaveBufferToImage() const
 	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
 }
 
+void Renderer::ToggleVertexCache()
+{
+	m_UseVertexCache = !m_UseVertexCache;
+
+	std::cout << "Vertex stage: " << (m_UseVertexCache ? "on demand through the post-transform cache" : "all vertices up front") << '\n';
+}
+
+void Renderer::CycleInstructionSet()
+{
+	const int next{ static_cast<int>(m_InstructionSet) + 1 };
+	m_InstructionSet = next > static_cast<int>(m_SupportedInstructionSet) ? RasterKernels::InstructionSet::Scalar : static_cast<RasterKernels::InstructionSet>(next);
+	m_pTriangleKernel = RasterKernels::GetTriangleKernel(m_InstructionSet);
+	m_pTransformKernel = VertexKernels::GetTransformKernel(m_InstructionSet);
+	m_pIndexedTransformKernel = VertexKernels::GetIndexedTransformKernel(m_InstructionSet);
+
+	std::cout << "Rasterizer path: " << RasterKernels::GetName(m_InstructionSet) << '\n';
+}
+
+void Renderer::CycleShadingMode()
+{
+	m_ShadingMode = static_cast<ShadingMode>((static_cast<int>(m_ShadingMode) + 1) % static_cast<int>(std::size(m_ShadingPasses)));
+
+	const char* names[]{ "depth buffer", "vertex color", "textured", "normal mapped" };
+	std::cout << "Shading: " << names[static_cast<int>(m_ShadingMode)] << '\n';
+}
+
+void Renderer::CycleTextureFilter()
+{
+	m_TextureFilter = static_cast<TextureFilter>((static_cast<int>(m_TextureFilter) + 1) % 3);
+
+	const char* names[]{ "point", "nearest mip", "trilinear" };
+	std::cout << "Texture filter: " << names[static_cast<int>(m_TextureFilter)] << '\n';
+}
+
+void Renderer::ToggleDeferredShading()
+{
+	m_UseDeferredShading = !m_UseDeferredShading;
+	std::cout << "Pixel shading: " << (m_UseDeferredShading ? "deferred, once per visible pixel" : "forward, once per depth test pass") << '\n';
+}
+
 void Renderer::ClearBackground() const
 {
 	SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
@@ -274,5 +994,17 @@ void Renderer::ClearBackground() const
 
 void Renderer::ResetDepthBuffer()
 {
-	std::fill_n(m_pDepthBufferPixels, (m_Width * m_Height), FLT_MAX);
+	std::fill_n(m_pDepthBufferPixels, (m_Stride * m_Height), FLT_MAX);
+	std::fill(m_HiZBlockMaxDepth.begin(), m_HiZBlockMaxDepth.end(), FLT_MAX);
+	std::fill(m_HiZRowMaxDepth.begin(), m_HiZRowMaxDepth.end(), FLT_MAX);
+	//Rows of the last block row that fall below the screen never get written, they must not hold up the max of their block
+	const int blockSize{ RasterKernels::HiZBlockSize };
+	const int nrRowsBelowScreen{ (blockSize - m_Height % blockSize) % blockSize };
+	const size_t lastBlockRow{ m_HiZBlockMaxDepth.size() - m_HiZBlockStride };
+	for (size_t block{ lastBlockRow }; nrRowsBelowScreen > 0 && block < m_HiZBlockMaxDepth.size(); ++block)
+	{
+		const auto rowsBelowScreen{ m_HiZRowMaxDepth.begin() + (block + 1) * blockSize - nrRowsBelowScreen };
+		std::fill(rowsBelowScreen, rowsBelowScreen + nrRowsBelowScreen, 0.f);
+	}
+	std::fill(m_HiZTileMaxDepth.begin(), m_HiZTileMaxDepth.end(), FLT_MAX);
 }
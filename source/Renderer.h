@@ -5,17 +5,23 @@
 
 #include "Camera.h"
 #include "DataTypes.h"
+#include "FrameArena.h"
+#include "PixelShaders.h"
+#include "RasterKernels.h"
+#include "Texture.h"
+#include "VertexCache.h"
+#include "VertexKernels.h"
 
 struct SDL_Window;
 struct SDL_Surface;
 
 namespace dae
 {
-	class Texture;
 	struct Mesh;
 	struct Vertex;
 	class Timer;
 	class Scene;
+	class ThreadPool;
 
 	class Renderer final
 	{
@@ -33,7 +39,54 @@ namespace dae
 
 		bool SaveBufferToImage() const;
 
+		//Triangles the cull stage removed during the last Render, per reason
+		const CullStats& GetCullStats() const { return m_CullStats; }
+		const FrameArena& GetFrameArena() const { return m_FrameArena; }
+		//Per mesh in the scene, only filled while the vertex cache is in use
+		const std::vector<VertexCacheStats>& GetVertexCacheStats() const { return m_VertexCacheStats; }
+
+		//Buffers of the last Render, GetBufferStride pixels from the start of one row to the next
+		const uint32_t* GetBackBufferPixels() const { return m_pBackBufferPixels; }
+		const float* GetDepthBufferPixels() const { return m_pDepthBufferPixels; }
+		//nullptr when the last Render didn't defer its shading, otherwise only valid where the depth buffer got written
+		const uint32_t* GetVisibilityBufferPixels() const { return m_RasterTarget.pVisibilityBuffer; }
+		int GetBufferStride() const { return m_Stride; }
+		RasterKernels::InstructionSet GetInstructionSet() const { return m_InstructionSet; }
+
+		//Switches between transforming vertices on demand through the post-transform cache and transforming all of them up front
+		void ToggleVertexCache();
+
+		//Switches to the next rasterizer path the CPU supports (Scalar -> SSE4.1 -> AVX2)
+		void CycleInstructionSet();
+
+		//Switches to the next shading mode (Depth -> VertexColor -> Textured -> NormalMapped)
+		void CycleShadingMode();
+		//Switches to the next texture filter (Point -> NearestMip -> Trilinear)
+		void CycleTextureFilter();
+		//Switches VertexColor, Textured and NormalMapped between shading every pixel that passes the depth test and shading only the visible ones after rasterizing, Depth has nothing to defer
+		void ToggleDeferredShading();
+
 	private:
+		enum class ShadingMode
+		{
+			Depth,
+			VertexColor,
+			Textured,
+			NormalMapped
+		};
+
+		//Passes over one tile, every one of them instantiated for one pixel shader
+		using TilePass = void(Renderer::*)(int tileIndex);
+		struct ShadingPasses
+		{
+			TilePass pRaster{};
+			//Deferred shading of the visible pixels, nullptr when the mode has nothing worth deferring
+			TilePass pShadeVisible{};
+			bool needsAttributes{};
+		};
+		//Indexed by ShadingMode, picked once per draw so the tile loops never branch on the mode
+		static const ShadingPasses m_ShadingPasses[];
+
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
@@ -41,22 +94,125 @@ namespace dae
 		uint32_t* m_pBackBufferPixels{};
 
 		float* m_pDepthBufferPixels{};
+		//Deferred shading: id of the triangle that owns every pixel, only valid where the depth buffer got written this frame
+		uint32_t* m_pVisibilityBufferPixels{};
 
 		Camera m_Camera{};
 
 		int m_Width{};
 		int m_Height{};
 
+		//Row pitch in pixels of the back and depth buffer, m_Width rounded up to a whole cache line
+		static constexpr int m_BufferAlignment{ 64 };
+		int m_Stride{};
+
 		float m_AspectRatio;
-		Texture* m_pTexture;
-		Mesh* m_pMesh;
+		//Diffuse, normal, gloss and specular map of the vehicle in one texture
+		Texture* m_pMaterial{};
+
+		ShadingMode m_ShadingMode{ ShadingMode::Depth };
+		TextureFilter m_TextureFilter{ TextureFilter::Trilinear };
+		bool m_UseDeferredShading{ true };
+
+		//Scene, kept for the whole lifetime of the renderer
+		std::vector<Mesh> m_Meshes{};
+
+		//Backs every buffer that only lives during one Render, reset at the start of it
+		FrameArena m_FrameArena{};
+
+		//Screen is split in tiles that get rasterized in parallel, every tile owns its own part of the buffers
+		//The triangles of tile i are m_BinnedTriangles[m_TileBinOffsets[i]] up to m_BinnedTriangles[m_TileBinOffsets[i + 1]]
+		static constexpr int m_TileSize{ 64 };
+		int m_NrTilesX{};
+		int m_NrTilesY{};
+		FrameVector<int> m_TileBinOffsets{};
+		FrameVector<int> m_BinnedTriangles{};
+		//Setups of every mesh drawn so far this frame, the deferred shading pass still needs them after the last mesh
+		FrameVector<TriangleSetup> m_TriangleSetups{};
+		//Same order as the setups, empty unless the shading mode needs attributes
+		FrameVector<AttributePlanes> m_TriangleAttributes{};
+		bool m_BuildAttributes{ false };
+		ThreadPool* m_pThreadPool{ nullptr };
+		CullStats m_CullStats{};
+
+		//Vertices per vertex stage job, a multiple of 8 so only the last chunk has a scalar tail
+		static constexpr size_t m_VertexChunkSize{ 4096 };
+		//Position transform outputs of the current mesh, clipped vertices get added at the back of the depths and 1/w
+		Matrix m_WorldViewProjection{};
+		VertexKernels::TransformTarget m_VertexTarget{};
+		FrameVector<float> m_VertexDepths{};
+		FrameVector<float> m_VertexInvW{};
+		//uv of the clipped vertices, the first one belongs to vertex index mesh.vertices.size()
+		FrameVector<Vector2> m_ClippedUVs{};
+
+		//On demand, only the vertices the indices use get transformed, and only when they missed the cache
+		bool m_UseVertexCache{ true };
+		VertexCache m_VertexCache{};
+		std::vector<VertexCacheStats> m_VertexCacheStats{};
+		//Vertices of the current mesh that missed the cache, each one once, in the order they first missed
+		FrameVector<uint32_t> m_VertexCacheMisses{};
+		FrameVector<uint16_t> m_ClipCodes{};
+
+		//Hi-Z buffer: max depth of every tile and of every 8x8 block, lets whole triangles and blocks get rejected before any per pixel work
+		std::vector<float> m_HiZTileMaxDepth{};
+		std::vector<float> m_HiZBlockMaxDepth{};
+		//Max depth of every row of every block, keeps a written block from having to look at all of its pixels again
+		std::vector<float> m_HiZRowMaxDepth{};
+		int m_HiZBlockStride{};
+
+		//SIMD kernel picked at startup from CPUID, nullptr means the scalar RenderMeshTriangle
+		//The kernels only write the depth visualization or triangle ids, the other pixel shaders take the scalar path
+		RasterKernels::InstructionSet m_SupportedInstructionSet{ RasterKernels::InstructionSet::Scalar };
+		RasterKernels::InstructionSet m_InstructionSet{ RasterKernels::InstructionSet::Scalar };
+		RasterKernels::TriangleKernel m_pTriangleKernel{ nullptr };
+		RasterKernels::RasterTarget m_RasterTarget{};
+		VertexKernels::TransformKernel m_pTransformKernel{ &VertexKernels::TransformPositions };
+		VertexKernels::IndexedTransformKernel m_pIndexedTransformKernel{ &VertexKernels::TransformIndexedPositions };
 
 		//Function that transforms the vertices from the mesh from World space to Screen space
 		void VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const;
-		void VertexTransformationFunction(const std::vector<Mesh>& meshes_in, std::vector<Mesh>& meshes_out) const;
+		//Adapter that still fills mesh.vertices_out with every attribute, for shading that needs more than positions
 		void VertexTransformationFunction(Mesh& mesh);
-
-		void RenderMeshTriangle(const Mesh& mesh, const std::vector<Vector2>& screenSpace, int vertexIndex, bool swapVertices);
+		//Same for only the listed vertices, the slots of the others stay empty
+		void VertexTransformationFunction(Mesh& mesh, const FrameVector<uint32_t>& vertexIndices);
+		//Every attribute of one vertex, what both of the above fill vertices_out with
+		Vertex_Out TransformVertex(const Mesh& mesh, const Matrix& worldViewProjectionMatrix, const Vertex& v) const;
+		//Hot path, only streams the positions through worldViewProjection into screenSpace, m_VertexDepths and m_ClipCodes
+		//With the vertex cache on this only sizes the outputs, TransformVertexCacheMisses fills them
+		void TransformMeshPositions(const Mesh& mesh, FrameVector<Vector2>& screenSpace);
+		//Runs the indices through the vertex cache before any triangle gets assembled, then transforms what missed in chunks on the thread pool
+		//Positions go through the batched kernel, the other attributes only when the shading mode needs them
+		void TransformVertexCacheMisses(Mesh& mesh, int indexStep, int endIndex);
+
+		Vector2 NdcToScreen(const Vector4& ndcPosition) const;
+
+		//Vertex indices of the triangle that starts at index, every odd triangle of a strip turned around
+		static void GetTriangleIndices(const Mesh& mesh, int index, uint32_t(&vertexIndices)[3]);
+		//Sets up the triangles of the mesh and sorts them in the tiles their bounding box touches
+		//Clipped triangles add their new vertices to the back of mesh.vertices_out and screenSpace
+		void BinMeshTriangles(Mesh& mesh, FrameVector<Vector2>& screenSpace);
+		void AddTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, uint32_t(&vertexIndices)[3]);
+		void ClipTriangle(Mesh& mesh, FrameVector<Vector2>& screenSpace, const uint32_t(&vertexIndices)[3], uint16_t clipCodes);
+		//Bins the setups from firstSetup on, the ones of the mesh that's being drawn
+		void FillTileBins(int firstSetup);
+		//Cull stage, returns true when the triangle can't show up on screen, turns kept back faces around so they have a positive area
+		bool CullTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, uint32_t(&vertexIndices)[3]);
+		bool SetupTriangle(const Mesh& mesh, const FrameVector<Vector2>& screenSpace, const uint32_t(&vertexIndices)[3], TriangleSetup& triangle) const;
+		//Plane through the values of the three vertices of the triangle
+		static ScreenPlane GetAttributePlane(const TriangleSetup& triangle, float value0, float value1, float value2);
+		AttributePlanes SetupAttributes(const Mesh& mesh, const TriangleSetup& triangle) const;
+		Vector2 GetVertexUV(const Mesh& mesh, uint32_t vertexIndex) const;
+		PixelShaders::ShadeContext GetShadeContext() const;
+		template<PixelShaders::PixelShader Shader>
+		void RenderTile(int tileIndex);
+		//Max of the blocks of the tile, only needed when a block that held the old one went down
+		void UpdateTileMaxDepth(int tileIndex, const Int2& tileTopLeft, const Int2& tileBotRight);
+		//Scalar rasterizer, returns what the triangle kernels do: the old max of the highest block it lowered, 0 when none
+		template<PixelShaders::PixelShader Shader>
+		float RenderMeshTriangle(const TriangleSetup& triangle, const Int2& tileTopLeft, const Int2& tileBotRight, Shader& shader);
+		//Deferred shading pass, shades every pixel of the tile the visibility buffer has a triangle for
+		template<PixelShaders::PixelShader Shader>
+		void ShadeVisibleTile(int tileIndex);
 
 		void ClearBackground() const;
 		void ResetDepthBuffer();
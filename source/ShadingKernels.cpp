@@ -0,0 +1,184 @@
+#include "ShadingKernels.h"
+#include "MathHelpers.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace ShadingKernels
+	{
+		namespace
+		{
+			//FastLog2, FastExp2 and FastPow of MathHelpers on 8 lanes
+			DAE_TARGET_AVX2 __m256 FastLog2AVX2(__m256 x)
+			{
+				const __m256i bits{ _mm256_castps_si256(x) };
+				const __m256 exponent{ _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127))) };
+				const __m256 m{ _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000))) };
+				__m256 p{ _mm256_add_ps(_mm256_set1_ps(-0.377923373f), _mm256_mul_ps(m, _mm256_set1_ps(0.0458788333f))) };
+				p = _mm256_add_ps(_mm256_set1_ps(1.27390807f), _mm256_mul_ps(m, p));
+				p = _mm256_add_ps(_mm256_set1_ps(-2.30624018f), _mm256_mul_ps(m, p));
+				p = _mm256_add_ps(_mm256_set1_ps(2.80620213f), _mm256_mul_ps(m, p));
+				return _mm256_add_ps(exponent, _mm256_mul_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.f)), p));
+			}
+
+			DAE_TARGET_AVX2 __m256 FastExp2AVX2(__m256 x)
+			{
+				x = _mm256_max_ps(x, _mm256_set1_ps(-126.f));
+				const __m256i whole{ _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(x, _mm256_set1_ps(127.f))), _mm256_set1_epi32(127)) };
+				const __m256 f{ _mm256_sub_ps(x, _mm256_cvtepi32_ps(whole)) };
+				__m256 p{ _mm256_add_ps(_mm256_set1_ps(0.0516670284f), _mm256_mul_ps(f, _mm256_set1_ps(0.0136765608f))) };
+				p = _mm256_add_ps(_mm256_set1_ps(0.241709986f), _mm256_mul_ps(f, p));
+				p = _mm256_add_ps(_mm256_set1_ps(0.692931415f), _mm256_mul_ps(f, p));
+				p = _mm256_add_ps(_mm256_set1_ps(1.00000727f), _mm256_mul_ps(f, p));
+				return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(whole, 23)));
+			}
+
+			DAE_TARGET_AVX2 __m256 Dot(const __m256 (&a)[3], const __m256 (&b)[3])
+			{
+				return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])), _mm256_mul_ps(a[2], b[2]));
+			}
+
+			DAE_TARGET_AVX2 void Load(const float (&source)[3][BatchSize], __m256 (&vector)[3])
+			{
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					vector[axis] = _mm256_loadu_ps(source[axis]);
+				}
+			}
+
+			DAE_TARGET_AVX2 __m256 Negate(__m256 x)
+			{
+				return _mm256_xor_ps(x, _mm256_set1_ps(-0.f));
+			}
+		}
+
+		LightKernel GetLightKernel(RasterKernels::InstructionSet instructionSet)
+		{
+			//Like the sample kernels, SSE4.1 machines take the scalar loop
+			if (instructionSet == RasterKernels::InstructionSet::AVX2)
+			{
+				return &LightNormalMappedAVX2;
+			}
+			return &LightNormalMapped;
+		}
+
+		void LightNormalMapped(const TextureKernels::SampleBatch& material, LightBatch& batch)
+		{
+			for (int lane{ 0 }; lane < BatchSize; ++lane)
+			{
+				//Interpolation shortens the vertex normals and tangents, the binormal follows from both
+				const float invNormalLength{ 1.f / std::sqrt(Square(batch.normal[0][lane]) + Square(batch.normal[1][lane]) + Square(batch.normal[2][lane])) };
+				const float normalX{ batch.normal[0][lane] * invNormalLength };
+				const float normalY{ batch.normal[1][lane] * invNormalLength };
+				const float normalZ{ batch.normal[2][lane] * invNormalLength };
+				const float invTangentLength{ 1.f / std::sqrt(Square(batch.tangent[0][lane]) + Square(batch.tangent[1][lane]) + Square(batch.tangent[2][lane])) };
+				const float tangentX{ batch.tangent[0][lane] * invTangentLength };
+				const float tangentY{ batch.tangent[1][lane] * invTangentLength };
+				const float tangentZ{ batch.tangent[2][lane] * invTangentLength };
+				const float binormalX{ normalY * tangentZ - normalZ * tangentY };
+				const float binormalY{ normalZ * tangentX - normalX * tangentZ };
+				const float binormalZ{ normalX * tangentY - normalY * tangentX };
+
+				//The sampled normal is a weighted sum of the tangent frame, no matrix gets built
+				const float sampleX{ 2.f * material.r[Normal][lane] - 1.f };
+				const float sampleY{ 2.f * material.g[Normal][lane] - 1.f };
+				const float sampleZ{ 2.f * material.b[Normal][lane] - 1.f };
+				float mappedX{ sampleX * tangentX + sampleY * binormalX + sampleZ * normalX };
+				float mappedY{ sampleX * tangentY + sampleY * binormalY + sampleZ * normalY };
+				float mappedZ{ sampleX * tangentZ + sampleY * binormalZ + sampleZ * normalZ };
+				const float invMappedLength{ 1.f / std::sqrt(Square(mappedX) + Square(mappedY) + Square(mappedZ)) };
+				mappedX *= invMappedLength;
+				mappedY *= invMappedLength;
+				mappedZ *= invMappedLength;
+
+				//Phong: the light reflected around the normal against the direction to the eye, which is minus the view direction
+				const float lightDotNormal{ LightDirection[0] * mappedX + LightDirection[1] * mappedY + LightDirection[2] * mappedZ };
+				const float reflectedX{ LightDirection[0] - 2.f * lightDotNormal * mappedX };
+				const float reflectedY{ LightDirection[1] - 2.f * lightDotNormal * mappedY };
+				const float reflectedZ{ LightDirection[2] - 2.f * lightDotNormal * mappedZ };
+				const float viewLength{ std::sqrt(Square(batch.viewDirection[0][lane]) + Square(batch.viewDirection[1][lane]) + Square(batch.viewDirection[2][lane])) };
+				const float reflectDotView{ -(reflectedX * batch.viewDirection[0][lane] + reflectedY * batch.viewDirection[1][lane] + reflectedZ * batch.viewDirection[2][lane]) / viewLength };
+
+				//Clamped the way maxps does, so -0 and NaN turn into 0 like in the AVX2 kernel
+				const float observedArea{ -lightDotNormal > 0.f ? -lightDotNormal : 0.f };
+				const float phong{ FastPow(reflectDotView > 0.f ? reflectDotView : 0.f, material.r[Gloss][lane] * Shininess) };
+
+				const float diffuseScale{ LightIntensity / PI * observedArea };
+				const float specularScale{ phong * observedArea };
+				batch.r[lane] = material.r[Diffuse][lane] * diffuseScale + material.r[Specular][lane] * specularScale + Ambient;
+				batch.g[lane] = material.g[Diffuse][lane] * diffuseScale + material.g[Specular][lane] * specularScale + Ambient;
+				batch.b[lane] = material.b[Diffuse][lane] * diffuseScale + material.b[Specular][lane] * specularScale + Ambient;
+			}
+		}
+
+		DAE_TARGET_AVX2 void LightNormalMappedAVX2(const TextureKernels::SampleBatch& material, LightBatch& batch)
+		{
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 two{ _mm256_set1_ps(2.f) };
+			const __m256 zero{ _mm256_setzero_ps() };
+
+			__m256 normal[3]{};
+			__m256 tangent[3]{};
+			__m256 viewDirection[3]{};
+			Load(batch.normal, normal);
+			Load(batch.tangent, tangent);
+			Load(batch.viewDirection, viewDirection);
+
+			const __m256 invNormalLength{ _mm256_div_ps(one, _mm256_sqrt_ps(Dot(normal, normal))) };
+			const __m256 invTangentLength{ _mm256_div_ps(one, _mm256_sqrt_ps(Dot(tangent, tangent))) };
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				normal[axis] = _mm256_mul_ps(normal[axis], invNormalLength);
+				tangent[axis] = _mm256_mul_ps(tangent[axis], invTangentLength);
+			}
+			const __m256 binormal[3]{
+				_mm256_sub_ps(_mm256_mul_ps(normal[1], tangent[2]), _mm256_mul_ps(normal[2], tangent[1])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[2], tangent[0]), _mm256_mul_ps(normal[0], tangent[2])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[0], tangent[1]), _mm256_mul_ps(normal[1], tangent[0]))
+			};
+
+			const __m256 sample[3]{
+				_mm256_sub_ps(_mm256_mul_ps(two, _mm256_loadu_ps(material.r[Normal])), one),
+				_mm256_sub_ps(_mm256_mul_ps(two, _mm256_loadu_ps(material.g[Normal])), one),
+				_mm256_sub_ps(_mm256_mul_ps(two, _mm256_loadu_ps(material.b[Normal])), one)
+			};
+			__m256 mapped[3]{};
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				mapped[axis] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sample[0], tangent[axis]), _mm256_mul_ps(sample[1], binormal[axis])), _mm256_mul_ps(sample[2], normal[axis]));
+			}
+			const __m256 invMappedLength{ _mm256_div_ps(one, _mm256_sqrt_ps(Dot(mapped, mapped))) };
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				mapped[axis] = _mm256_mul_ps(mapped[axis], invMappedLength);
+			}
+
+			const __m256 lightDirection[3]{ _mm256_set1_ps(LightDirection[0]), _mm256_set1_ps(LightDirection[1]), _mm256_set1_ps(LightDirection[2]) };
+			const __m256 lightDotNormal{ Dot(lightDirection, mapped) };
+			__m256 reflected[3]{};
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				reflected[axis] = _mm256_sub_ps(lightDirection[axis], _mm256_mul_ps(_mm256_mul_ps(two, lightDotNormal), mapped[axis]));
+			}
+			const __m256 viewLength{ _mm256_sqrt_ps(Dot(viewDirection, viewDirection)) };
+			const __m256 reflectDotView{ _mm256_div_ps(Negate(Dot(reflected, viewDirection)), viewLength) };
+
+			const __m256 observedArea{ _mm256_max_ps(Negate(lightDotNormal), zero) };
+			const __m256 exponent{ _mm256_mul_ps(_mm256_loadu_ps(material.r[Gloss]), _mm256_set1_ps(Shininess)) };
+			const __m256 phong{ FastExp2AVX2(_mm256_mul_ps(exponent, FastLog2AVX2(_mm256_max_ps(reflectDotView, zero)))) };
+
+			const __m256 diffuseScale{ _mm256_mul_ps(_mm256_set1_ps(LightIntensity / PI), observedArea) };
+			const __m256 specularScale{ _mm256_mul_ps(phong, observedArea) };
+			const __m256 ambient{ _mm256_set1_ps(Ambient) };
+			float* channels[3]{ batch.r, batch.g, batch.b };
+			const float (*materialChannels[3])[BatchSize]{ material.r, material.g, material.b };
+			for (int channel{ 0 }; channel < 3; ++channel)
+			{
+				const __m256 lit{ _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(materialChannels[channel][Diffuse]), diffuseScale), _mm256_mul_ps(_mm256_loadu_ps(materialChannels[channel][Specular]), specularScale)) };
+				_mm256_storeu_ps(channels[channel], _mm256_add_ps(lit, ambient));
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "RasterKernels.h"
+#include "TextureKernels.h"
+
+namespace dae
+{
+	namespace ShadingKernels
+	{
+		using TextureKernels::BatchSize;
+
+		//Planes of a material texture, one image each
+		enum MaterialPlane
+		{
+			Diffuse,
+			Normal,
+			Gloss,
+			Specular
+		};
+
+		//The one directional light, pointing from the light into the scene
+		constexpr float LightDirection[3]{ .577f, -.577f, .577f };
+		constexpr float LightIntensity{ 7.f };
+		//Phong exponent of a gloss of 1
+		constexpr float Shininess{ 25.f };
+		constexpr float Ambient{ .025f };
+
+		//Interpolated world space vectors in, lit colors out, SoA like the SampleBatch the material comes in
+		//None of the vectors has to be normalized, the view direction runs from the camera to the pixel
+		struct LightBatch
+		{
+			float normal[3][BatchSize]{};
+			float tangent[3][BatchSize]{};
+			float viewDirection[3][BatchSize]{};
+
+			float r[BatchSize]{};
+			float g[BatchSize]{};
+			float b[BatchSize]{};
+		};
+
+		//Lambert plus Phong with the normal from the tangent space normal map of the material, every lane gets lit
+		//Bit-identical on every instruction set, see RasterKernels::InstructionSet
+		using LightKernel = void(*)(const TextureKernels::SampleBatch& material, LightBatch& batch);
+
+		LightKernel GetLightKernel(RasterKernels::InstructionSet instructionSet);
+
+		void LightNormalMapped(const TextureKernels::SampleBatch& material, LightBatch& batch);
+		void LightNormalMappedAVX2(const TextureKernels::SampleBatch& material, LightBatch& batch);
+	}
+}
@@ -1,44 +1,372 @@
 #include "Texture.h"
+#include "MathHelpers.h"
 #include "Vector2.h"
 #include <SDL_image.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <new>
+
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	Texture::Texture(const std::vector<SDL_Surface*>& surfaces, TextureLayout layout) :
+		m_Width{ surfaces.front()->w },
+		m_Height{ surfaces.front()->h },
+		m_Layout{ layout },
+		m_IsPowerOfTwo{ (m_Width & (m_Width - 1)) == 0 && (m_Height & (m_Height - 1)) == 0 },
+		m_NrPlanes{ static_cast<int>(surfaces.size()) }
 	{
+		SetAddressMode(TextureAddress::Wrap);
+
+		while ((1 << m_PlaneShift) < m_NrPlanes)
+		{
+			++m_PlaneShift;
+		}
+
+		std::vector<std::vector<uint32_t>> planes(m_NrPlanes);
+		for (int plane{ 0 }; plane < m_NrPlanes; ++plane)
+		{
+			const SDL_Surface* pSurface{ surfaces[plane] };
+			std::vector<uint32_t>& texels{ planes[plane] };
+			texels.resize(static_cast<size_t>(m_Width) * m_Height);
+			for (int y{ 0 }; y < m_Height; ++y)
+			{
+				std::memcpy(&texels[static_cast<size_t>(y) * m_Width], static_cast<const uint8_t*>(pSurface->pixels) + y * pSurface->pitch, m_Width * sizeof(uint32_t));
+			}
+		}
+
+		BuildMipLevels(planes);
+		StoreTexels(planes);
 	}
 
 	Texture::~Texture()
 	{
-		if (m_pSurface)
+		::operator delete[](m_pTexels, std::align_val_t{ m_TexelAlignment });
+	}
+
+	Texture* Texture::LoadFromFile(const std::string& path, TextureLayout layout)
+	{
+		return LoadFromFiles({ path }, layout);
+	}
+
+	Texture* Texture::LoadFromFiles(const std::vector<std::string>& paths, TextureLayout layout)
+	{
+		if (paths.empty() || paths.size() > TextureKernels::MaxPlanes)
+		{
+			return nullptr;
+		}
+
+		std::vector<SDL_Surface*> surfaces{};
+		bool isValid{ true };
+		for (const std::string& path : paths)
+		{
+			SDL_Surface* pLoaded{ IMG_Load(path.c_str()) };
+			if (!pLoaded)
+			{
+				isValid = false;
+				break;
+			}
+
+			//Decoding through the surface's pixel format happens once here instead of in every Sample
+			//ABGR8888 is a packed format, so the shifts in UnpackColor hold on any byte order
+			SDL_Surface* pSurface{ SDL_ConvertSurfaceFormat(pLoaded, SDL_PIXELFORMAT_ABGR8888, 0) };
+			SDL_FreeSurface(pLoaded);
+			if (!pSurface)
+			{
+				isValid = false;
+				break;
+			}
+
+			//Every plane is addressed with the same levels, so they all need the size of the first
+			surfaces.push_back(pSurface);
+			if (pSurface->w != surfaces.front()->w || pSurface->h != surfaces.front()->h)
+			{
+				isValid = false;
+				break;
+			}
+		}
+
+		Texture* pTexture{ isValid ? new Texture{ surfaces, layout } : nullptr };
+		for (SDL_Surface* pSurface : surfaces)
 		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
+			SDL_FreeSurface(pSurface);
 		}
+		return pTexture;
 	}
 
-	Texture* Texture::LoadFromFile(const std::string& path)
+	ColorRGB Texture::Sample(const Vector2& uv) const
 	{
-		return new Texture{IMG_Load(path.c_str())};
+		//Straight to level 0, no sampler call, filter or address mode in between, so uv has to be in [0, 1)
+		//Inside that range it is the texel FetchNearest picks, truncating and flooring agree for positive coordinates
+		const MipLevel& level{ m_MipLevels[0] };
+		const int x{ static_cast<int>(uv.x * level.width) };
+		const int y{ static_cast<int>(uv.y * level.height) };
+		return TextureKernels::UnpackColor(*TextureKernels::GetTexel(GetTexelSource(), level, x, y));
 	}
 
-	ColorRGB Texture::Sample(const Vector2& uv) const
+	ColorRGB Texture::Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, TextureFilter filter) const
 	{
-		Uint8 r;
-		Uint8 g;
-		Uint8 b;
+		return (this->*m_pSample)(uv, uvDdx, uvDdy, filter);
+	}
 
-		const size_t x{ static_cast<size_t>(uv.x * m_pSurface->w) };
-		const size_t y{ static_cast<size_t>(uv.y * m_pSurface->h) };
+	template<TextureAddress address, bool powerOfTwo>
+	ColorRGB Texture::SampleAddressed(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, TextureFilter filter) const
+	{
+		const TextureKernels::TexelSource source{ GetTexelSource() };
+		switch (filter)
+		{
+		case TextureFilter::NearestMip:
+			return TextureKernels::UnpackColor(*TextureKernels::FetchNearest<address, powerOfTwo>(source, m_MipLevels[GetNearestMipLevel(ComputeMipLevel(uvDdx, uvDdy))], uv.x, uv.y));
+		case TextureFilter::Trilinear:
+		{
+			const float mipLevel{ std::min(ComputeMipLevel(uvDdx, uvDdy), static_cast<float>(GetNrMipLevels() - 1)) };
+			const int level{ static_cast<int>(mipLevel) };
+			const ColorRGB color{ TextureKernels::FetchBilinear<address, powerOfTwo>(source, m_MipLevels[level], uv.x, uv.y).Blend(0) };
+			if (level + 1 == GetNrMipLevels())
+			{
+				return color;
+			}
+			return ColorRGB::Lerp(color, TextureKernels::FetchBilinear<address, powerOfTwo>(source, m_MipLevels[level + 1], uv.x, uv.y).Blend(0), mipLevel - level);
+		}
+		default:
+			return TextureKernels::UnpackColor(*TextureKernels::FetchNearest<address, powerOfTwo>(source, m_MipLevels[0], uv.x, uv.y));
+		}
+	}
 
-		const Uint32 pixel{ m_pSurfacePixels[x + y * m_pSurface->w] };
+	void Texture::Sample(TextureKernels::SampleBatch& batch, const float(&mipLevels)[TextureKernels::BatchSize], TextureFilter filter, RasterKernels::InstructionSet instructionSet, int nrPlanes) const
+	{
+		using TextureKernels::BatchSize;
+		const TextureKernels::SampleKernels& kernels{ m_SampleKernels[static_cast<int>(instructionSet)] };
+		//The planes keep their place in the texels, the kernels just stop before the rest
+		TextureKernels::TexelSource source{ GetTexelSource() };
+		source.nrPlanes = std::min(nrPlanes, m_NrPlanes);
 
-		SDL_GetRGB(pixel, m_pSurface->format, &r, &g, &b);
+		switch (filter)
+		{
+		case TextureFilter::NearestMip:
+			for (int lane{ 0 }; lane < BatchSize; ++lane)
+			{
+				batch.level[lane] = GetNearestMipLevel(mipLevels[lane]);
+			}
+			kernels.pPoint(source, batch);
+			return;
+		case TextureFilter::Trilinear:
+		{
+			//Both levels get sampled for every lane, the top level blends with itself by a factor of 0, which leaves its color as is
+			TextureKernels::SampleBatch nextLevel{ batch };
+			float blend[BatchSize]{};
+			const int topLevel{ GetNrMipLevels() - 1 };
+			for (int lane{ 0 }; lane < BatchSize; ++lane)
+			{
+				const float mipLevel{ std::min(mipLevels[lane], static_cast<float>(topLevel)) };
+				batch.level[lane] = static_cast<int>(mipLevel);
+				nextLevel.level[lane] = std::min(batch.level[lane] + 1, topLevel);
+				blend[lane] = mipLevel - batch.level[lane];
+			}
 
-		const constexpr float clamp{ 1 / 255.f };
+			kernels.pBilinear(source, batch);
+			kernels.pBilinear(source, nextLevel);
+			for (int plane{ 0 }; plane < source.nrPlanes; ++plane)
+			{
+				for (int lane{ 0 }; lane < BatchSize; ++lane)
+				{
+					batch.r[plane][lane] = Lerpf(batch.r[plane][lane], nextLevel.r[plane][lane], blend[lane]);
+					batch.g[plane][lane] = Lerpf(batch.g[plane][lane], nextLevel.g[plane][lane], blend[lane]);
+					batch.b[plane][lane] = Lerpf(batch.b[plane][lane], nextLevel.b[plane][lane], blend[lane]);
+				}
+			}
+			return;
+		}
+		default:
+			std::fill(std::begin(batch.level), std::end(batch.level), 0);
+			kernels.pPoint(source, batch);
+			return;
+		}
+	}
+
+	void Texture::SetAddressMode(TextureAddress address)
+	{
+		m_Address = address;
+		switch (address)
+		{
+		case TextureAddress::Clamp:
+			m_pSample = m_IsPowerOfTwo ? &Texture::SampleAddressed<TextureAddress::Clamp, true> : &Texture::SampleAddressed<TextureAddress::Clamp, false>;
+			break;
+		case TextureAddress::Mirror:
+			m_pSample = m_IsPowerOfTwo ? &Texture::SampleAddressed<TextureAddress::Mirror, true> : &Texture::SampleAddressed<TextureAddress::Mirror, false>;
+			break;
+		default:
+			m_pSample = m_IsPowerOfTwo ? &Texture::SampleAddressed<TextureAddress::Wrap, true> : &Texture::SampleAddressed<TextureAddress::Wrap, false>;
+			break;
+		}
 
-		return { r * clamp,g * clamp,b * clamp };
+		for (int instructionSet{ 0 }; instructionSet < static_cast<int>(std::size(m_SampleKernels)); ++instructionSet)
+		{
+			m_SampleKernels[instructionSet] = TextureKernels::GetSampleKernels(static_cast<RasterKernels::InstructionSet>(instructionSet), address, m_IsPowerOfTwo);
+		}
+	}
+
+	float Texture::ComputeMipLevel(const Vector2& uvDdx, const Vector2& uvDdy) const
+	{
+		//Longest side of the pixel footprint in level 0 texels, every level up halves it
+		const Vector2 texelDdx{ uvDdx.x * m_Width, uvDdx.y * m_Height };
+		const Vector2 texelDdy{ uvDdy.x * m_Width, uvDdy.y * m_Height };
+		const float footprintSquared{ std::max(texelDdx.SqrMagnitude(), texelDdy.SqrMagnitude()) };
+		if (footprintSquared <= 1.f)
+		{
+			return 0.f;
+		}
+
+		//log2 of the square root without taking the root
+		return 0.5f * std::log2(footprintSquared);
+	}
+
+	int Texture::GetNearestMipLevel(float mipLevel) const
+	{
+		return std::clamp(static_cast<int>(mipLevel + 0.5f), 0, GetNrMipLevels() - 1);
+	}
+
+	void Texture::BuildMipLevels(std::vector<std::vector<uint32_t>>& planes)
+	{
+		m_MipLevels.push_back({ m_Width, m_Height, m_Width, 0 });
+		if (m_Width == 0 || m_Height == 0)
+		{
+			return;
+		}
+
+		while (m_MipLevels.back().width > 1 || m_MipLevels.back().height > 1)
+		{
+			const MipLevel& source{ m_MipLevels.back() };
+			const int width{ std::max(source.width / 2, 1) };
+			const MipLevel level{ width, std::max(source.height / 2, 1), width, 0 };
+			m_MipLevels.push_back(level);
+		}
+
+		size_t nrTexels{ 0 };
+		for (const MipLevel& level : m_MipLevels)
+		{
+			nrTexels += static_cast<size_t>(level.width) * level.height;
+		}
+
+		for (size_t levelIndex{ 1 }; levelIndex < m_MipLevels.size(); ++levelIndex)
+		{
+			const MipLevel& source{ m_MipLevels[levelIndex - 1] };
+			m_MipLevels[levelIndex].offset = source.offset + source.width * source.height;
+		}
+
+		//Every plane is filtered on its own, a normal map gets averaged like any other image
+		for (std::vector<uint32_t>& texels : planes)
+		{
+			texels.resize(nrTexels);
+			for (size_t levelIndex{ 1 }; levelIndex < m_MipLevels.size(); ++levelIndex)
+			{
+				BoxFilterLevel(texels, m_MipLevels[levelIndex - 1], m_MipLevels[levelIndex]);
+			}
+		}
+	}
+
+	void Texture::BoxFilterLevel(std::vector<uint32_t>& texels, const MipLevel& source, const MipLevel& level)
+	{
+		//2x2 box filter, a source side of 1 texel just gets read twice
+		const uint32_t* pSource{ texels.data() + source.offset };
+		uint32_t* pLevel{ texels.data() + level.offset };
+		for (int y{ 0 }; y < level.height; ++y)
+		{
+			const int sourceY0{ std::min(y * 2, source.height - 1) };
+			const int sourceY1{ std::min(y * 2 + 1, source.height - 1) };
+			for (int x{ 0 }; x < level.width; ++x)
+			{
+				const int sourceX0{ std::min(x * 2, source.width - 1) };
+				const int sourceX1{ std::min(x * 2 + 1, source.width - 1) };
+				const uint32_t texels[4]{ pSource[sourceX0 + sourceY0 * source.width], pSource[sourceX1 + sourceY0 * source.width],
+					pSource[sourceX0 + sourceY1 * source.width], pSource[sourceX1 + sourceY1 * source.width] };
+
+				uint32_t texel{ 0 };
+				for (int shift{ 0 }; shift < 32; shift += 8)
+				{
+					uint32_t sum{ 2 };
+					for (const uint32_t sourceTexel : texels)
+					{
+						sum += (sourceTexel >> shift) & 0xFF;
+					}
+					texel |= (sum / 4) << shift;
+				}
+				pLevel[x + y * level.width] = texel;
+			}
+		}
+	}
+
+	void Texture::StoreTexels(const std::vector<std::vector<uint32_t>>& planes)
+	{
+		const std::vector<MipLevel> sourceLevels{ m_MipLevels };
+
+		using TextureKernels::TileSize;
+
+		size_t nrTexels{ planes.front().size() };
+		if (m_Layout == TextureLayout::Tiled)
+		{
+			//Every level gets padded to whole tiles, which moves the offsets
+			nrTexels = 0;
+			for (MipLevel& level : m_MipLevels)
+			{
+				const int nrTilesX{ (level.width + TileSize - 1) / TileSize };
+				const int nrTilesY{ (level.height + TileSize - 1) / TileSize };
+				level.offset = static_cast<int32_t>(nrTexels);
+				level.pitch = nrTilesX * TileSize * TileSize;
+				nrTexels += static_cast<size_t>(level.pitch) * nrTilesY;
+			}
+		}
+
+		const size_t nrSlots{ nrTexels << m_PlaneShift };
+		m_pTexels = static_cast<uint32_t*>(::operator new[](nrSlots * sizeof(uint32_t), std::align_val_t{ m_TexelAlignment }));
+		if (m_NrPlanes < 1 << m_PlaneShift)
+		{
+			//The padding planes never get sampled, cleared only so no texel is left uninitialized
+			std::memset(m_pTexels, 0, nrSlots * sizeof(uint32_t));
+		}
+
+		if (m_Layout == TextureLayout::Linear)
+		{
+			if (m_NrPlanes == 1)
+			{
+				std::memcpy(m_pTexels, planes.front().data(), nrTexels * sizeof(uint32_t));
+				return;
+			}
+
+			for (size_t texel{ 0 }; texel < nrTexels; ++texel)
+			{
+				for (int plane{ 0 }; plane < m_NrPlanes; ++plane)
+				{
+					m_pTexels[(texel << m_PlaneShift) + plane] = planes[plane][texel];
+				}
+			}
+			return;
+		}
+
+		for (size_t levelIndex{ 0 }; levelIndex < m_MipLevels.size(); ++levelIndex)
+		{
+			const MipLevel& level{ m_MipLevels[levelIndex] };
+			const MipLevel& source{ sourceLevels[levelIndex] };
+			const int paddedWidth{ (level.width + TileSize - 1) / TileSize * TileSize };
+			const int paddedHeight{ (level.height + TileSize - 1) / TileSize * TileSize };
+
+			//Sampling clamps before it gets to the padding, it repeats the edge only so no texel is left uninitialized
+			//Levels below the tile size still take a whole tile, a few pages for the whole chain
+			for (int y{ 0 }; y < paddedHeight; ++y)
+			{
+				const size_t sourceRow{ static_cast<size_t>(source.offset) + static_cast<size_t>(std::min(y, source.height - 1)) * source.pitch };
+				for (int x{ 0 }; x < paddedWidth; ++x)
+				{
+					const size_t slot{ (level.offset + TextureKernels::GetTexelIndex(m_Layout, level.pitch, x, y)) << m_PlaneShift };
+					const size_t sourceTexel{ sourceRow + std::min(x, source.width - 1) };
+					for (int plane{ 0 }; plane < m_NrPlanes; ++plane)
+					{
+						m_pTexels[slot + plane] = planes[plane][sourceTexel];
+					}
+				}
+			}
+		}
 	}
-}
\ No newline at end of file
+}
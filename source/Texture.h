@@ -1,24 +1,106 @@
 #pragma once
 #include <SDL_surface.h>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include "ColorRGB.h"
+#include "TextureKernels.h"
 
 namespace dae
 {
 	struct Vector2;
 
-	class Texture
+	//How a sample with known uv derivatives picks its texels
+	enum class TextureFilter
+	{
+		//Nearest texel of the full resolution image, what Sample(uv) does
+		Point,
+		//Nearest texel of the mip level closest to the pixel footprint
+		NearestMip,
+		//Bilinear in the two mip levels around the footprint, blended between them
+		Trilinear
+	};
+
+	class Texture final
 	{
 	public:
+		//Tiled by default for the material the renderer draws with, 4 planes of 1024x1024 where trilinear over rotated uvs is cheaper tiled
+		//Textures that fit in the caches, like 512x512 with one plane, sample about as fast in either layout, Bench rotation measures both
+		//Returns nullptr when the image can't be loaded or converted
+		static Texture* LoadFromFile(const std::string& path, TextureLayout layout = TextureLayout::Tiled);
+		//One plane per image, interleaved so a batched sample reads all of them from one address, see TexelSource
+		//Returns nullptr when any image can't be loaded or converted, the sizes differ or there are more than MaxPlanes
+		static Texture* LoadFromFiles(const std::vector<std::string>& paths, TextureLayout layout = TextureLayout::Tiled);
 		~Texture();
 
-		static Texture* LoadFromFile(const std::string& path);
+		Texture(const Texture&) = delete;
+		Texture(Texture&&) noexcept = delete;
+		Texture& operator=(const Texture&) = delete;
+		Texture& operator=(Texture&&) noexcept = delete;
+
+		//Nearest texel of level 0 for a uv in [0, 1), without addressing, the fast path for callers that know their uvs stay inside
 		ColorRGB Sample(const Vector2& uv) const;
+		//uvDdx and uvDdy are how much uv changes from one pixel to the next horizontally and vertically, they decide the mip level
+		ColorRGB Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, TextureFilter filter) const;
+		//The single uv Samples only read plane 0
+		//Batched Sample, mipLevels are what ComputeMipLevel gave for every lane
+		//Fills in the levels of the batch, every lane of every plane gets the exact color the single uv Sample would give for that plane
+		//Only the first nrPlanes planes get sampled, the colors of the others are left as they were
+		void Sample(TextureKernels::SampleBatch& batch, const float(&mipLevels)[TextureKernels::BatchSize], TextureFilter filter, RasterKernels::InstructionSet instructionSet, int nrPlanes = TextureKernels::MaxPlanes) const;
+
+		//Mip level the footprint of one pixel maps to, 0 when the texture is magnified
+		float ComputeMipLevel(const Vector2& uvDdx, const Vector2& uvDdy) const;
+
+		//Wrap by default, picks the samplers built for the mode so sampling itself never checks it
+		void SetAddressMode(TextureAddress address);
+		TextureAddress GetAddressMode() const { return m_Address; }
+		bool IsPowerOfTwo() const { return m_IsPowerOfTwo; }
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		//Ordered as GetLayout says, every mip level after the other
+		const uint32_t* GetTexels() const { return m_pTexels; }
+		TextureLayout GetLayout() const { return m_Layout; }
+		int GetNrMipLevels() const { return static_cast<int>(m_MipLevels.size()); }
+		int GetNrPlanes() const { return m_NrPlanes; }
+		TextureKernels::TexelSource GetTexelSource() const { return { m_pTexels, m_MipLevels.data(), m_Layout, m_NrPlanes, m_PlaneShift }; }
 
 	private:
-		Texture(SDL_Surface* pSurface);
+		//One ABGR8888 surface per plane, all of the same size
+		Texture(const std::vector<SDL_Surface*>& surfaces, TextureLayout layout);
+
+		using MipLevel = TextureKernels::TexelLevel;
+
+		static constexpr size_t m_TexelAlignment{ 4096 };
+
+		int m_Width{};
+		int m_Height{};
+		TextureLayout m_Layout{};
+		TextureAddress m_Address{};
+		bool m_IsPowerOfTwo{};
+		int m_NrPlanes{};
+		int m_PlaneShift{ 0 };
+		//Level 0 is the full image, each next one half the size down to 1x1, less than 2^31 texels in all
+		//Aligned to a page, so every block of the Tiled layout is exactly one cache line and every tile one page
+		uint32_t* m_pTexels{};
+		std::vector<MipLevel> m_MipLevels{};
+
+		//Fills in m_MipLevels and appends the levels to the texels of every plane, all rows without padding
+		void BuildMipLevels(std::vector<std::vector<uint32_t>>& planes);
+		static void BoxFilterLevel(std::vector<uint32_t>& texels, const MipLevel& source, const MipLevel& level);
+		//Copies the row after row levels of every plane to m_pTexels in m_Layout, interleaved
+		void StoreTexels(const std::vector<std::vector<uint32_t>>& planes);
+
+		//The single uv Sample for one address mode, SetAddressMode points m_pSample at the right one
+		using SampleFunction = ColorRGB(Texture::*)(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, TextureFilter filter) const;
+		template<TextureAddress address, bool powerOfTwo>
+		ColorRGB SampleAddressed(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, TextureFilter filter) const;
+
+		SampleFunction m_pSample{};
+		//Batched kernels for the address mode, per instruction set
+		TextureKernels::SampleKernels m_SampleKernels[static_cast<int>(RasterKernels::InstructionSet::AVX2) + 1]{};
 
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+		//Level a footprint of ComputeMipLevel's size rounds to, nearest mip sampling uses it
+		int GetNearestMipLevel(float mipLevel) const;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,262 @@
+#include "TextureKernels.h"
+#include "MathHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace TextureKernels
+	{
+		namespace
+		{
+			static_assert(sizeof(TexelLevel) == 4 * sizeof(int32_t), "The AVX2 kernels gather the fields of a level as 4 ints");
+			static_assert(BlockSize == 4 && TileSize == 32, "The AVX2 texel index is written out in shifts for these sizes");
+
+			//The 4 fields of the level every lane uses
+			struct LevelLanes
+			{
+				__m256i width;
+				__m256i height;
+				__m256i pitch;
+				__m256i offset;
+			};
+
+			DAE_TARGET_AVX2 LevelLanes GatherLevels(const TexelSource& source, const SampleBatch& batch)
+			{
+				const int* pFields{ reinterpret_cast<const int*>(source.pLevels) };
+				const __m256i first{ _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(batch.level)), 2) };
+				return {
+					_mm256_i32gather_epi32(pFields, first, 4),
+					_mm256_i32gather_epi32(pFields + 1, first, 4),
+					_mm256_i32gather_epi32(pFields + 2, first, 4),
+					_mm256_i32gather_epi32(pFields + 3, first, 4)
+				};
+			}
+
+			//Same as GetTexel, x and y are already clamped to the level
+			DAE_TARGET_AVX2 __m256i GetTexelIndices(const TexelSource& source, const LevelLanes& levels, __m256i x, __m256i y)
+			{
+				__m256i index{};
+				if (source.layout == TextureLayout::Tiled)
+				{
+					const __m256i blockMask{ _mm256_set1_epi32(7) };
+					const __m256i texelMask{ _mm256_set1_epi32(3) };
+					const __m256i tile{ _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, 5), levels.pitch), _mm256_slli_epi32(_mm256_srli_epi32(x, 5), 10)) };
+					const __m256i block{ _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(y, 2), blockMask), 7), _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(x, 2), blockMask), 4)) };
+					const __m256i texel{ _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, texelMask), 2), _mm256_and_si256(x, texelMask)) };
+					index = _mm256_add_epi32(_mm256_add_epi32(tile, block), texel);
+				}
+				else
+				{
+					index = _mm256_add_epi32(x, _mm256_mullo_epi32(y, levels.pitch));
+				}
+				return _mm256_sll_epi32(_mm256_add_epi32(index, levels.offset), _mm_cvtsi32_si128(source.planeShift));
+			}
+
+			DAE_TARGET_AVX2 __m256i GatherPlane(const TexelSource& source, __m256i texelIndices, int plane)
+			{
+				return _mm256_i32gather_epi32(reinterpret_cast<const int*>(source.pTexels + plane), texelIndices, 4);
+			}
+
+			DAE_TARGET_AVX2 __m256i Clamp(__m256i value, __m256i max)
+			{
+				return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), max);
+			}
+
+			//Same as AddressCoordinate
+			template<TextureAddress address, bool powerOfTwo>
+			DAE_TARGET_AVX2 __m256 AddressCoordinates(__m256 coordinates)
+			{
+				if constexpr (!powerOfTwo && address == TextureAddress::Wrap)
+				{
+					return _mm256_sub_ps(coordinates, _mm256_floor_ps(coordinates));
+				}
+				else if constexpr (!powerOfTwo && address == TextureAddress::Mirror)
+				{
+					const __m256 one{ _mm256_set1_ps(1.f) };
+					const __m256 period{ _mm256_sub_ps(coordinates, _mm256_mul_ps(_mm256_set1_ps(2.f), _mm256_floor_ps(_mm256_mul_ps(coordinates, _mm256_set1_ps(0.5f))))) };
+					const __m256 distance{ _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_sub_ps(period, one)) };
+					return _mm256_sub_ps(one, distance);
+				}
+				else
+				{
+					return coordinates;
+				}
+			}
+
+			//Same as AddressTexel
+			template<TextureAddress address, bool powerOfTwo>
+			DAE_TARGET_AVX2 __m256i AddressTexels(__m256i texels, __m256i sizes)
+			{
+				const __m256i one{ _mm256_set1_epi32(1) };
+				if constexpr (powerOfTwo && address == TextureAddress::Wrap)
+				{
+					return _mm256_and_si256(texels, _mm256_sub_epi32(sizes, one));
+				}
+				else if constexpr (powerOfTwo && address == TextureAddress::Mirror)
+				{
+					const __m256i mask{ _mm256_sub_epi32(_mm256_add_epi32(sizes, sizes), one) };
+					const __m256i period{ _mm256_and_si256(texels, mask) };
+					const __m256i isForward{ _mm256_cmpeq_epi32(_mm256_and_si256(period, sizes), _mm256_setzero_si256()) };
+					return _mm256_xor_si256(period, _mm256_andnot_si256(isForward, mask));
+				}
+				else if constexpr (address == TextureAddress::Wrap)
+				{
+					const __m256i maxTexels{ _mm256_sub_epi32(sizes, one) };
+					texels = _mm256_add_epi32(texels, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), texels), sizes));
+					texels = _mm256_sub_epi32(texels, _mm256_and_si256(_mm256_cmpgt_epi32(texels, maxTexels), sizes));
+					return Clamp(texels, maxTexels);
+				}
+				else
+				{
+					return Clamp(texels, _mm256_sub_epi32(sizes, one));
+				}
+			}
+
+			//Same math as UnpackColor, channel at shift 0, 8 or 16
+			DAE_TARGET_AVX2 __m256 UnpackChannel(__m256i texels, int shift)
+			{
+				constexpr float toFloat{ 1 / 255.f };
+				const __m256i channel{ _mm256_and_si256(_mm256_srli_epi32(texels, shift), _mm256_set1_epi32(0xFF)) };
+				return _mm256_mul_ps(_mm256_cvtepi32_ps(channel), _mm256_set1_ps(toFloat));
+			}
+
+			//Same order as Lerpf: ((1 - factor) * a) + (factor * b)
+			DAE_TARGET_AVX2 __m256 Lerp(__m256 a, __m256 b, __m256 factor)
+			{
+				return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.f), factor), a), _mm256_mul_ps(factor, b));
+			}
+		}
+
+		template<TextureAddress address, bool powerOfTwo>
+		void SamplePoint(const TexelSource& source, SampleBatch& batch)
+		{
+			for (int lane{ 0 }; lane < BatchSize; ++lane)
+			{
+				const uint32_t* pTexel{ FetchNearest<address, powerOfTwo>(source, source.pLevels[batch.level[lane]], batch.u[lane], batch.v[lane]) };
+				for (int plane{ 0 }; plane < source.nrPlanes; ++plane)
+				{
+					const ColorRGB color{ UnpackColor(pTexel[plane]) };
+					batch.r[plane][lane] = color.r;
+					batch.g[plane][lane] = color.g;
+					batch.b[plane][lane] = color.b;
+				}
+			}
+		}
+
+		template<TextureAddress address, bool powerOfTwo>
+		void SampleBilinear(const TexelSource& source, SampleBatch& batch)
+		{
+			for (int lane{ 0 }; lane < BatchSize; ++lane)
+			{
+				const BilinearFootprint footprint{ FetchBilinear<address, powerOfTwo>(source, source.pLevels[batch.level[lane]], batch.u[lane], batch.v[lane]) };
+				for (int plane{ 0 }; plane < source.nrPlanes; ++plane)
+				{
+					const ColorRGB color{ footprint.Blend(plane) };
+					batch.r[plane][lane] = color.r;
+					batch.g[plane][lane] = color.g;
+					batch.b[plane][lane] = color.b;
+				}
+			}
+		}
+
+		template<TextureAddress address, bool powerOfTwo>
+		DAE_TARGET_AVX2 void SamplePointAVX2(const TexelSource& source, SampleBatch& batch)
+		{
+			const LevelLanes levels{ GatherLevels(source, batch) };
+
+			const __m256 u{ AddressCoordinates<address, powerOfTwo>(_mm256_loadu_ps(batch.u)) };
+			const __m256 v{ AddressCoordinates<address, powerOfTwo>(_mm256_loadu_ps(batch.v)) };
+			const __m256i x{ AddressTexels<address, powerOfTwo>(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(u, _mm256_cvtepi32_ps(levels.width)))), levels.width) };
+			const __m256i y{ AddressTexels<address, powerOfTwo>(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(v, _mm256_cvtepi32_ps(levels.height)))), levels.height) };
+
+			const __m256i texelIndices{ GetTexelIndices(source, levels, x, y) };
+			for (int plane{ 0 }; plane < source.nrPlanes; ++plane)
+			{
+				const __m256i texels{ GatherPlane(source, texelIndices, plane) };
+				_mm256_storeu_ps(batch.r[plane], UnpackChannel(texels, 0));
+				_mm256_storeu_ps(batch.g[plane], UnpackChannel(texels, 8));
+				_mm256_storeu_ps(batch.b[plane], UnpackChannel(texels, 16));
+			}
+		}
+
+		template<TextureAddress address, bool powerOfTwo>
+		DAE_TARGET_AVX2 void SampleBilinearAVX2(const TexelSource& source, SampleBatch& batch)
+		{
+			const LevelLanes levels{ GatherLevels(source, batch) };
+			const __m256i one{ _mm256_set1_epi32(1) };
+			const __m256 half{ _mm256_set1_ps(0.5f) };
+
+			const __m256 texelX{ _mm256_sub_ps(_mm256_mul_ps(AddressCoordinates<address, powerOfTwo>(_mm256_loadu_ps(batch.u)), _mm256_cvtepi32_ps(levels.width)), half) };
+			const __m256 texelY{ _mm256_sub_ps(_mm256_mul_ps(AddressCoordinates<address, powerOfTwo>(_mm256_loadu_ps(batch.v)), _mm256_cvtepi32_ps(levels.height)), half) };
+			const __m256 floorX{ _mm256_floor_ps(texelX) };
+			const __m256 floorY{ _mm256_floor_ps(texelY) };
+			const __m256 weightX{ _mm256_sub_ps(texelX, floorX) };
+			const __m256 weightY{ _mm256_sub_ps(texelY, floorY) };
+
+			const __m256i cornerX{ _mm256_cvttps_epi32(floorX) };
+			const __m256i cornerY{ _mm256_cvttps_epi32(floorY) };
+			const __m256i x0{ AddressTexels<address, powerOfTwo>(cornerX, levels.width) };
+			const __m256i x1{ AddressTexels<address, powerOfTwo>(_mm256_add_epi32(cornerX, one), levels.width) };
+			const __m256i y0{ AddressTexels<address, powerOfTwo>(cornerY, levels.height) };
+			const __m256i y1{ AddressTexels<address, powerOfTwo>(_mm256_add_epi32(cornerY, one), levels.height) };
+
+			const __m256i indices00{ GetTexelIndices(source, levels, x0, y0) };
+			const __m256i indices10{ GetTexelIndices(source, levels, x1, y0) };
+			const __m256i indices01{ GetTexelIndices(source, levels, x0, y1) };
+			const __m256i indices11{ GetTexelIndices(source, levels, x1, y1) };
+
+			for (int plane{ 0 }; plane < source.nrPlanes; ++plane)
+			{
+				const __m256i texels00{ GatherPlane(source, indices00, plane) };
+				const __m256i texels10{ GatherPlane(source, indices10, plane) };
+				const __m256i texels01{ GatherPlane(source, indices01, plane) };
+				const __m256i texels11{ GatherPlane(source, indices11, plane) };
+
+				float* channels[3]{ batch.r[plane], batch.g[plane], batch.b[plane] };
+				for (int channel{ 0 }; channel < 3; ++channel)
+				{
+					const int shift{ channel * 8 };
+					const __m256 top{ Lerp(UnpackChannel(texels00, shift), UnpackChannel(texels10, shift), weightX) };
+					const __m256 bottom{ Lerp(UnpackChannel(texels01, shift), UnpackChannel(texels11, shift), weightX) };
+					_mm256_storeu_ps(channels[channel], Lerp(top, bottom, weightY));
+				}
+			}
+		}
+
+		namespace
+		{
+			template<TextureAddress address, bool powerOfTwo>
+			SampleKernels GetKernels(RasterKernels::InstructionSet instructionSet)
+			{
+				//Without AVX2 there are no gathers, SSE4.1 machines take the scalar loops
+				if (instructionSet == RasterKernels::InstructionSet::AVX2)
+				{
+					return { &SamplePointAVX2<address, powerOfTwo>, &SampleBilinearAVX2<address, powerOfTwo> };
+				}
+				return { &SamplePoint<address, powerOfTwo>, &SampleBilinear<address, powerOfTwo> };
+			}
+
+			template<TextureAddress address>
+			SampleKernels GetKernels(RasterKernels::InstructionSet instructionSet, bool powerOfTwo)
+			{
+				return powerOfTwo ? GetKernels<address, true>(instructionSet) : GetKernels<address, false>(instructionSet);
+			}
+		}
+
+		SampleKernels GetSampleKernels(RasterKernels::InstructionSet instructionSet, TextureAddress address, bool powerOfTwo)
+		{
+			switch (address)
+			{
+			case TextureAddress::Clamp:
+				return GetKernels<TextureAddress::Clamp>(instructionSet, powerOfTwo);
+			case TextureAddress::Mirror:
+				return GetKernels<TextureAddress::Mirror>(instructionSet, powerOfTwo);
+			default:
+				return GetKernels<TextureAddress::Wrap>(instructionSet, powerOfTwo);
+			}
+		}
+	}
+}
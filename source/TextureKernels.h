@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "ColorRGB.h"
+#include "RasterKernels.h"
+
+namespace dae
+{
+	//How the texels of every mip level are ordered in memory
+	enum class TextureLayout
+	{
+		//Row after row, a sample walking down a column touches a new cache line every texel
+		Linear,
+		//4x4 blocks of 64 bytes, one cache line each, grouped in 32x32 tiles of 4 KB, one page each, the tiles row after row
+		//A footprint costs about the same cache lines and pages whichever way the uvs run across the screen
+		Tiled
+	};
+
+	//What a sample does with uvs outside [0, 1]
+	enum class TextureAddress
+	{
+		//Repeats the texture, 1.25 samples what 0.25 does
+		Wrap,
+		//Stretches the edge texels outward
+		Clamp,
+		//Repeats the texture flipped every other time, so the copies meet without a seam
+		Mirror
+	};
+
+	namespace TextureKernels
+	{
+		constexpr int BlockSize{ 4 };
+		constexpr int TileSize{ 32 };
+
+		//uvs per batch, one AVX2 register of floats
+		constexpr int BatchSize{ 8 };
+		//Images one texture can interleave, see TexelSource
+		constexpr int MaxPlanes{ 4 };
+
+		//One mip level, 32 bit fields so the AVX2 kernels can gather them per lane
+		struct TexelLevel
+		{
+			int32_t width{};
+			int32_t height{};
+			//Texels from the start of one row to the next, for Tiled from one row of tiles to the next
+			int32_t pitch{};
+			//Where the level starts in the texels of the texture
+			int32_t offset{};
+		};
+
+		//Every mip level of a texture, pLevels[i] describes level i
+		//A texture can interleave up to MaxPlanes images of the same size, its planes: texel i of every plane sits next to each other,
+		//from (level offset + texel index) << planeShift on, so one address and mostly one cache line serve all of them
+		struct TexelSource
+		{
+			const uint32_t* pTexels{};
+			const TexelLevel* pLevels{};
+			TextureLayout layout{};
+			int32_t nrPlanes{ 1 };
+			//log2 of nrPlanes rounded up to a power of two, the planes past nrPlanes are padding
+			int32_t planeShift{ 0 };
+		};
+
+		//uvs and mip levels in, colors of every plane out, SoA so a kernel works on whole registers
+		//Every lane gets sampled, lanes the caller doesn't need just have to hold a valid level
+		struct SampleBatch
+		{
+			float u[BatchSize]{};
+			float v[BatchSize]{};
+			int32_t level[BatchSize]{};
+
+			float r[MaxPlanes][BatchSize]{};
+			float g[MaxPlanes][BatchSize]{};
+			float b[MaxPlanes][BatchSize]{};
+		};
+
+		//Bit-identical to Texture::Sample on every instruction set, see RasterKernels::InstructionSet
+		using SampleKernel = void(*)(const TexelSource& source, SampleBatch& batch);
+
+		struct SampleKernels
+		{
+			SampleKernel pPoint{};
+			SampleKernel pBilinear{};
+		};
+
+		//Point and bilinear sampling, scalar loops or AVX2, built for one address mode
+		//powerOfTwo: both sides of level 0 are powers of two, so every level is and wrapping is a mask
+		SampleKernels GetSampleKernels(RasterKernels::InstructionSet instructionSet, TextureAddress address, bool powerOfTwo);
+
+		//Every texel packed as RGBA8: red in the lowest byte, alpha in the highest, whatever the file stored
+		inline ColorRGB UnpackColor(uint32_t texel)
+		{
+			constexpr float toFloat{ 1 / 255.f };
+			return { (texel & 0xFF) * toFloat, ((texel >> 8) & 0xFF) * toFloat, ((texel >> 16) & 0xFF) * toFloat };
+		}
+
+		//Index of texel (x, y) from the start of its level
+		inline size_t GetTexelIndex(TextureLayout layout, int32_t pitch, int x, int y)
+		{
+			//Unsigned, so the divisions and remainders by the block and tile size turn into shifts and masks
+			const size_t column{ static_cast<size_t>(x) };
+			const size_t row{ static_cast<size_t>(y) };
+			if (layout == TextureLayout::Tiled)
+			{
+				const size_t tile{ row / TileSize * pitch + column / TileSize * (TileSize * TileSize) };
+				const size_t block{ row % TileSize / BlockSize * (TileSize * BlockSize) + column % TileSize / BlockSize * (BlockSize * BlockSize) };
+				return tile + block + row % BlockSize * BlockSize + column % BlockSize;
+			}
+			return column + row * pitch;
+		}
+
+		//Addressing happens in two steps, both picked at compile time so a sampler never branches on the mode
+		//Sizes that aren't a power of two fold the uv into [0, 1] first, so the texel step only has to fix up the one texel a bilinear footprint can stick out by
+		template<TextureAddress address, bool powerOfTwo>
+		float AddressCoordinate(float coordinate)
+		{
+			if constexpr (!powerOfTwo && address == TextureAddress::Wrap)
+			{
+				return coordinate - std::floor(coordinate);
+			}
+			else if constexpr (!powerOfTwo && address == TextureAddress::Mirror)
+			{
+				//Triangle wave with a period of 2: 0 -> 0, 1 -> 1, 2 -> 0
+				const float period{ coordinate - 2.f * std::floor(coordinate * 0.5f) };
+				return 1.f - std::abs(period - 1.f);
+			}
+			else
+			{
+				return coordinate;
+			}
+		}
+
+		//Turns any texel coordinate into one inside [0, size), without branches
+		template<TextureAddress address, bool powerOfTwo>
+		int AddressTexel(int texel, int size)
+		{
+			if constexpr (powerOfTwo && address == TextureAddress::Wrap)
+			{
+				return texel & (size - 1);
+			}
+			else if constexpr (powerOfTwo && address == TextureAddress::Mirror)
+			{
+				//Every odd repeat runs backwards, which for a power of two is flipping all the bits below 2 * size
+				const int period{ texel & (2 * size - 1) };
+				return period ^ ((period & size) != 0 ? 2 * size - 1 : 0);
+			}
+			else if constexpr (address == TextureAddress::Wrap)
+			{
+				texel += texel < 0 ? size : 0;
+				texel -= texel >= size ? size : 0;
+				//The uv was folded already, this only keeps NaN and infinite uvs inside the level
+				return std::clamp(texel, 0, size - 1);
+			}
+			else
+			{
+				//Also where mirrored non power of two sizes end up: the edge texel repeats once, like it does in the mirror image
+				return std::clamp(texel, 0, size - 1);
+			}
+		}
+
+		//Where texel (x, y) of the level starts in the texels, its other planes follow it
+		inline const uint32_t* GetTexel(const TexelSource& source, const TexelLevel& level, int x, int y)
+		{
+			return source.pTexels + ((level.offset + GetTexelIndex(source.layout, level.pitch, x, y)) << source.planeShift);
+		}
+
+		//std::floor without the library call it compiles to below SSE4.1, the same for every float but -0, which comes out as 0 and gives the same texel and weight
+		//From 2^23 on every float is whole already, below that truncating through an int and stepping down for negatives floors
+		inline float FloorTexel(float value)
+		{
+			const bool isFractional{ std::abs(value) < 8388608.f };
+			const float truncated{ static_cast<float>(static_cast<int>(isFractional ? value : 0.f)) };
+			return isFractional ? truncated - (value < truncated ? 1.f : 0.f) : value;
+		}
+
+		//The 4 texels around uv with their blend weights, the same for every plane
+		struct BilinearFootprint
+		{
+			const uint32_t* pTexels[4]{};
+			float weightX{};
+			float weightY{};
+
+			ColorRGB Blend(int plane) const
+			{
+				const ColorRGB top{ ColorRGB::Lerp(UnpackColor(pTexels[0][plane]), UnpackColor(pTexels[1][plane]), weightX) };
+				const ColorRGB bottom{ ColorRGB::Lerp(UnpackColor(pTexels[2][plane]), UnpackColor(pTexels[3][plane]), weightX) };
+				return ColorRGB::Lerp(top, bottom, weightY);
+			}
+		};
+
+		//The texel nearest to uv, or the 4 around it for a bilinear blend, what the batched kernels do per lane
+		//Addressed once, every plane is read from there
+		template<TextureAddress address, bool powerOfTwo>
+		const uint32_t* FetchNearest(const TexelSource& source, const TexelLevel& level, float u, float v)
+		{
+			const int x{ AddressTexel<address, powerOfTwo>(static_cast<int>(FloorTexel(AddressCoordinate<address, powerOfTwo>(u) * level.width)), level.width) };
+			const int y{ AddressTexel<address, powerOfTwo>(static_cast<int>(FloorTexel(AddressCoordinate<address, powerOfTwo>(v) * level.height)), level.height) };
+			return GetTexel(source, level, x, y);
+		}
+
+		template<TextureAddress address, bool powerOfTwo>
+		BilinearFootprint FetchBilinear(const TexelSource& source, const TexelLevel& level, float u, float v)
+		{
+			//Texel centers sit at half coordinates
+			const float texelX{ AddressCoordinate<address, powerOfTwo>(u) * level.width - 0.5f };
+			const float texelY{ AddressCoordinate<address, powerOfTwo>(v) * level.height - 0.5f };
+			const float floorX{ FloorTexel(texelX) };
+			const float floorY{ FloorTexel(texelY) };
+
+			const int x0{ AddressTexel<address, powerOfTwo>(static_cast<int>(floorX), level.width) };
+			const int x1{ AddressTexel<address, powerOfTwo>(static_cast<int>(floorX) + 1, level.width) };
+			const int y0{ AddressTexel<address, powerOfTwo>(static_cast<int>(floorY), level.height) };
+			const int y1{ AddressTexel<address, powerOfTwo>(static_cast<int>(floorY) + 1, level.height) };
+
+			return { { GetTexel(source, level, x0, y0), GetTexel(source, level, x1, y0), GetTexel(source, level, x0, y1), GetTexel(source, level, x1, y1) }, texelX - floorX, texelY - floorY };
+		}
+	}
+}
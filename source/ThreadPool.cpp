@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+using namespace dae;
+
+ThreadPool::ThreadPool(uint32_t nrThreads)
+{
+	//hardware_concurrency is allowed to return 0 when it can't tell
+	const uint32_t nrWorkers{ nrThreads > 1 ? nrThreads - 1 : 0 };
+
+	m_Workers.reserve(nrWorkers);
+	for (uint32_t i{ 0 }; i < nrWorkers; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t count, JobFunction pJobFunction, const void* pJob)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_pJobFunction = pJobFunction;
+		m_pJob = pJob;
+		m_JobCount = count;
+		m_NextJobIndex = 0;
+		m_NrBusyWorkers = static_cast<uint32_t>(m_Workers.size());
+		++m_Generation;
+	}
+	m_WakeCondition.notify_all();
+
+	//The calling thread works along instead of sitting idle
+	RunJobs();
+
+	std::unique_lock lock{ m_Mutex };
+	m_DoneCondition.wait(lock, [this] { return m_NrBusyWorkers == 0; });
+	m_pJobFunction = nullptr;
+	m_pJob = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint32_t seenGeneration{ 0 };
+
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_WakeCondition.wait(lock, [&] { return m_IsStopping || m_Generation != seenGeneration; });
+
+			if (m_IsStopping)
+			{
+				return;
+			}
+			seenGeneration = m_Generation;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			--m_NrBusyWorkers;
+		}
+		m_DoneCondition.notify_one();
+	}
+}
+
+void ThreadPool::RunJobs()
+{
+	for (uint32_t index{ m_NextJobIndex++ }; index < m_JobCount; index = m_NextJobIndex++)
+	{
+		m_pJobFunction(m_pJob, index);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	class ThreadPool final
+	{
+	public:
+		//nrThreads includes the calling thread, which always helps out during ParallelFor
+		ThreadPool(uint32_t nrThreads = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Calls job(index) for every index in [0, count) spread over all threads, returns once every index is done
+		//The job is only referenced, never copied, so no capture list is too big and nothing gets allocated
+		template<typename Job>
+		void ParallelFor(uint32_t count, const Job& job)
+		{
+			ParallelFor(count, [](const void* pJob, uint32_t index) { (*static_cast<const Job*>(pJob))(index); }, &job);
+		}
+
+		uint32_t GetNrThreads() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+	private:
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		using JobFunction = void(*)(const void* pJob, uint32_t index);
+
+		JobFunction m_pJobFunction{ nullptr };
+		const void* m_pJob{ nullptr };
+		uint32_t m_JobCount{};
+		std::atomic<uint32_t> m_NextJobIndex{};
+
+		uint32_t m_Generation{};
+		uint32_t m_NrBusyWorkers{};
+		bool m_IsStopping{ false };
+
+		void ParallelFor(uint32_t count, JobFunction pJobFunction, const void* pJob);
+		void WorkerLoop();
+		void RunJobs();
+	};
+}
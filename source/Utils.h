@@ -1,8 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <string>
 #include "Math.h"
 #include "DataTypes.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
 //#define DISABLE_OBJ
 
@@ -10,171 +16,491 @@ namespace dae
 {
 	namespace Utils
 	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
+		//The position/uv/normal indices of one face corner, 0 when the corner leaves that attribute out
+		struct ObjCorner
 		{
-#ifdef DISABLE_OBJ
+			uint32_t iPosition{};
+			uint32_t iTexCoord{};
+			uint32_t iNormal{};
 
-			//TODO: Enable the code below after uncommenting all the vertex attributes of DataTypes::Vertex
-			// >> Comment/Remove '#define DISABLE_OBJ'
-			assert(false && "OBJ PARSER not enabled! Check the comments in Utils::ParseOBJ");
+			bool operator==(const ObjCorner& other) const
+			{
+				return iPosition == other.iPosition && iTexCoord == other.iTexCoord && iNormal == other.iNormal;
+			}
+		};
 
-#else
+		//Unit vector orthogonal to normal, along x when there's no normal to be orthogonal to
+		inline Vector3 GetOrthogonalTangent(const Vector3& normal)
+		{
+			//Crossing with the axis the normal is least along keeps the result far from 0
+			const Vector3 tangent = Vector3::Cross(normal, std::abs(normal.x) < std::abs(normal.y) ? Vector3::UnitX : Vector3::UnitY);
+			return tangent.SqrMagnitude() > 0.f ? tangent.Normalized() : Vector3::UnitX;
+		}
+
+		//Tokenizing straight out of the mapped file, every helper moves pCursor past what it read
+		//None of them reads past a newline, so they don't check for the end of the text as long as a newline follows pCursor
+		inline bool IsObjBlank(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		inline bool IsObjDigit(char c)
+		{
+			return static_cast<unsigned char>(c - '0') < 10;
+		}
 
-			std::ifstream file(filename);
-			if (!file)
+		inline void SkipObjBlanks(const char*& pCursor)
+		{
+			while (IsObjBlank(*pCursor))
+				++pCursor;
+		}
+
+		//Leaves pCursor at the start of the next line
+		inline void SkipObjLine(const char*& pCursor)
+		{
+			while (*pCursor != '\n')
+				++pCursor;
+			++pCursor;
+		}
+
+		//The command is the first word of the line, moves pCursor past it when it's this one
+		template<size_t Size>
+		inline bool SkipObjCommand(const char*& pCursor, const char (&command)[Size])
+		{
+			for (size_t i = 0; i < Size - 1; ++i)
+			{
+				if (pCursor[i] != command[i])
+					return false;
+			}
+			if (!IsObjBlank(pCursor[Size - 1]) && pCursor[Size - 1] != '\n')
 				return false;
 
-			std::vector<Vector3> positions{};
-			std::vector<Vector3> normals{};
-			std::vector<Vector2> UVs{};
+			pCursor += Size - 1;
+			return true;
+		}
 
-			vertices.clear();
-			indices.clear();
+		inline uint32_t ParseObjIndex(const char*& pCursor)
+		{
+			uint32_t value{ 0 };
+			while (IsObjDigit(*pCursor))
+			{
+				value = value * 10 + static_cast<uint32_t>(*pCursor - '0');
+				++pCursor;
+			}
+			return value;
+		}
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
+		//Exporters write short decimals like -3.6527: as long as the digits fit in a float's 24 bit mantissa and there are at most 10 after the point,
+		//both the digits and the power of ten are exact floats and one division rounds the same way strtof does
+		//Anything longer, or with an exponent, goes through std::from_chars, which gets pEnd to stop at
+		inline float ParseObjFloat(const char*& pCursor, const char* pEnd)
+		{
+			static constexpr float powersOfTen[]{ 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+			static constexpr int maxNrDigits{ 18 };
+
+			const char* pDigits{ pCursor };
+			const bool isNegative{ *pDigits == '-' };
+			if (isNegative || *pDigits == '+')
+				++pDigits;
+
+			const char* p{ pDigits };
+			uint64_t mantissa{ 0 };
+			while (IsObjDigit(*p))
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				++p;
+			}
+			const char* const pPoint{ p };
+			if (*p == '.')
 			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
+				++p;
+				while (IsObjDigit(*p))
 				{
-					// Ignore Comment
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					++p;
 				}
-				else if (sCommand == "v")
+			}
+
+			const int nrDecimals{ *pPoint == '.' ? int(p - pPoint) - 1 : 0 };
+			const int nrDigits{ int(p - pDigits) - (*pPoint == '.') };
+			const bool hasExponent{ *p == 'e' || *p == 'E' };
+			if (nrDigits > 0 && nrDigits <= maxNrDigits && !hasExponent && mantissa <= (uint64_t{ 1 } << 24) && nrDecimals < int(std::size(powersOfTen)))
+			{
+				pCursor = p;
+				//The mantissa fits in 24 bits here, converting it as a signed number takes one instruction
+				const float value{ static_cast<float>(static_cast<int32_t>(mantissa)) / powersOfTen[nrDecimals] };
+				return isNegative ? -value : value;
+			}
+
+			//from_chars doesn't take a leading '+'
+			float value{};
+			const std::from_chars_result result{ std::from_chars(*pCursor == '+' ? pDigits : pCursor, pEnd, value) };
+			pCursor = result.ptr;
+			return value;
+		}
+
+		//Everything one line-aligned piece of an OBJ file defines, faces keep the file's 1-based indices
+		struct ObjChunk
+		{
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> normals{};
+			std::vector<Vector2> UVs{};
+			std::vector<ObjCorner> corners{};
+		};
+
+		//Every line in [pCursor, pEnd) ends in a newline
+		inline void ParseObjLines(const char* pCursor, const char* pEnd, ObjChunk& chunk)
+		{
+			while (pCursor < pEnd)
+			{
+				SkipObjBlanks(pCursor);
+				if (SkipObjCommand(pCursor, "v"))
 				{
 					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
+					float xyz[3];
+					for (float& coordinate : xyz)
+					{
+						SkipObjBlanks(pCursor);
+						coordinate = ParseObjFloat(pCursor, pEnd);
+					}
 
-					positions.emplace_back(x, y, z);
+					chunk.positions.emplace_back(xyz[0], xyz[1], xyz[2]);
 				}
-				else if (sCommand == "vt")
+				else if (SkipObjCommand(pCursor, "vt"))
 				{
 					// Vertex TexCoord
-					float u, v;
-					file >> u >> v;
-					UVs.emplace_back(u, 1 - v);
+					SkipObjBlanks(pCursor);
+					const float u{ ParseObjFloat(pCursor, pEnd) };
+					SkipObjBlanks(pCursor);
+					const float v{ ParseObjFloat(pCursor, pEnd) };
+					chunk.UVs.emplace_back(u, 1 - v);
 				}
-				else if (sCommand == "vn")
+				else if (SkipObjCommand(pCursor, "vn"))
 				{
 					// Vertex Normal
-					float x, y, z;
-					file >> x >> y >> z;
+					float xyz[3];
+					for (float& coordinate : xyz)
+					{
+						SkipObjBlanks(pCursor);
+						coordinate = ParseObjFloat(pCursor, pEnd);
+					}
 
-					normals.emplace_back(x, y, z);
+					chunk.normals.emplace_back(xyz[0], xyz[1], xyz[2]);
 				}
-				else if (sCommand == "f")
+				else if (SkipObjCommand(pCursor, "f"))
 				{
-					//if a face is read:
-					//construct the 3 vertices, add them to the vertex array
-					//add three indices to the index array
-					//add the material index as attibute to the attribute array
-					//
 					// Faces or triangles
-					Vertex vertex{};
-					size_t iPosition, iTexCoord, iNormal;
-
-					uint32_t tempIndices[3];
 					for (size_t iFace = 0; iFace < 3; iFace++)
 					{
 						// OBJ format uses 1-based arrays
-						file >> iPosition;
-						vertex.position = positions[iPosition - 1];
+						ObjCorner corner{};
+						SkipObjBlanks(pCursor);
+						corner.iPosition = ParseObjIndex(pCursor);
 
-						if ('/' == file.peek())//is next in buffer ==  '/' ?
+						if ('/' == *pCursor)
 						{
-							file.ignore();//read and ignore one element ('/')
+							++pCursor;
 
-							if ('/' != file.peek())
-							{
-								// Optional texture coordinate
-								file >> iTexCoord;
-								vertex.uv = UVs[iTexCoord - 1];
-							}
+							// Optional texture coordinate
+							corner.iTexCoord = ParseObjIndex(pCursor);
 
-							if ('/' == file.peek())
+							if ('/' == *pCursor)
 							{
-								file.ignore();
+								++pCursor;
 
 								// Optional vertex normal
-								file >> iNormal;
-								vertex.normal = normals[iNormal - 1];
+								corner.iNormal = ParseObjIndex(pCursor);
 							}
 						}
 
-						vertices.push_back(vertex);
-						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
-						//indices.push_back(uint32_t(vertices.size()) - 1);
-					}
-
-					indices.push_back(tempIndices[0]);
-					if (flipAxisAndWinding) 
-					{
-						indices.push_back(tempIndices[2]);
-						indices.push_back(tempIndices[1]);
-					}
-					else
-					{
-						indices.push_back(tempIndices[1]);
-						indices.push_back(tempIndices[2]);
+						chunk.corners.push_back(corner);
 					}
 				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
+				//Comments, groups and anything else: ignore the rest of the line
+				SkipObjLine(pCursor);
+			}
+		}
+
+		//Parses the lines up to the last newline in place, a last line without one from a copy that gets it
+		inline void ParseObjChunk(const char* pBegin, const char* pEnd, ObjChunk& chunk)
+		{
+			const char* pLastLine{ pEnd };
+			while (pLastLine > pBegin && pLastLine[-1] != '\n')
+				--pLastLine;
+
+			ParseObjLines(pBegin, pLastLine, chunk);
+			if (pLastLine < pEnd)
+			{
+				const std::string lastLine{ std::string{ pLastLine, pEnd } + '\n' };
+				ParseObjLines(lastLine.data(), lastLine.data() + lastLine.size(), chunk);
+			}
+		}
+
+		//Appends the same member of every chunk into one array, each chunk copies to the offset the counts before it add up to
+		//A single chunk just hands its array over
+		template<typename T>
+		void StitchObjChunks(std::vector<ObjChunk>& chunks, std::vector<T> ObjChunk::* pMember, std::vector<T>& result, ThreadPool* pThreadPool)
+		{
+			if (chunks.size() == 1)
+			{
+				result.swap(chunks[0].*pMember);
+				return;
 			}
 
-			//Cheap Tangent Calculations
-			for (uint32_t i = 0; i < indices.size(); i += 3)
+			std::vector<size_t> offsets(chunks.size() + 1);
+			for (size_t chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+				offsets[chunkIndex + 1] = offsets[chunkIndex] + (chunks[chunkIndex].*pMember).size();
+
+			result.resize(offsets.back());
+			const auto copyChunk = [&](uint32_t chunkIndex)
+			{
+				std::vector<T>& part{ chunks[chunkIndex].*pMember };
+				std::copy(part.begin(), part.end(), result.begin() + offsets[chunkIndex]);
+				std::vector<T>{}.swap(part);
+			};
+
+			if (pThreadPool)
+				pThreadPool->ParallelFor(uint32_t(chunks.size()), copyChunk);
+			else
+				for (uint32_t chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+					copyChunk(chunkIndex);
+		}
+
+		//Splits [0, count) into a few ranges per thread and hands them to job(begin, end), on the calling thread only when there is no pool
+		template<typename Job>
+		void ForEachObjRange(size_t count, ThreadPool* pThreadPool, const Job& job)
+		{
+			if (!pThreadPool || count == 0)
 			{
-				uint32_t index0 = indices[i];
-				uint32_t index1 = indices[size_t(i) + 1];
-				uint32_t index2 = indices[size_t(i) + 2];
+				job(size_t{ 0 }, count);
+				return;
+			}
+
+			const size_t nrRanges{ std::min(count, size_t{ pThreadPool->GetNrThreads() } * 4) };
+			pThreadPool->ParallelFor(uint32_t(nrRanges), [&](uint32_t rangeIndex)
+				{
+					job(count * rangeIndex / nrRanges, count * (rangeIndex + 1) / nrRanges);
+				});
+		}
+
+		//Parses vertices and indices, face corners with the same position/uv/normal share one vertex
+		//With a thread pool the file gets split into line-aligned chunks that are parsed in parallel, the result is the same either way
+#pragma warning(push)
+#pragma warning(disable : 4505) //Warning unreferenced local function
+		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true, ThreadPool* pThreadPool = nullptr)
+		{
+#ifdef DISABLE_OBJ
+
+			//TODO: Enable the code below after uncommenting all the vertex attributes of DataTypes::Vertex
+			// >> Comment/Remove '#define DISABLE_OBJ'
+			assert(false && "OBJ PARSER not enabled! Check the comments in Utils::ParseOBJ");
 
-				const Vector3& p0 = vertices[index0].position;
-				const Vector3& p1 = vertices[index1].position;
-				const Vector3& p2 = vertices[index2].position;
-				const Vector2& uv0 = vertices[index0].uv;
-				const Vector2& uv1 = vertices[index1].uv;
-				const Vector2& uv2 = vertices[index2].uv;
+#else
+
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
 
-				const Vector3 edge0 = p1 - p0;
-				const Vector3 edge1 = p2 - p0;
-				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
-				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-				float r = 1.f / Vector2::Cross(diffX, diffY);
+			vertices.clear();
+			indices.clear();
 
-				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
-				vertices[index0].tangent += tangent;
-				vertices[index1].tangent += tangent;
-				vertices[index2].tangent += tangent;
+			//A pool of one thread has nothing to split the work over, it would only add the stitching
+			if (pThreadPool && pThreadPool->GetNrThreads() == 1)
+				pThreadPool = nullptr;
+
+			//A few chunks per thread so one slow chunk doesn't keep the others waiting, but none so small the bookkeeping shows
+			//Without a thread pool the whole file is one chunk, which the stitching below takes over without a copy
+			static constexpr size_t minChunkSize{ size_t{ 1 } << 20 };
+			const char* const pBegin{ file.GetData() };
+			const char* const pEnd{ pBegin + file.GetSize() };
+			const size_t nrChunks{ pThreadPool ? std::max(size_t{ 1 }, std::min(size_t{ pThreadPool->GetNrThreads() } * 4, file.GetSize() / minChunkSize)) : 1 };
+
+			//Every chunk starts right after a newline, so no record gets cut in half
+			std::vector<const char*> chunkStarts(nrChunks + 1, pEnd);
+			chunkStarts[0] = pBegin;
+			for (size_t chunkIndex = 1; chunkIndex < nrChunks; ++chunkIndex)
+			{
+				const char* pStart{ std::max(chunkStarts[chunkIndex - 1], pBegin + file.GetSize() / nrChunks * chunkIndex) };
+				if (pStart > pBegin && pStart[-1] != '\n')
+				{
+					pStart = std::find(pStart, pEnd, '\n');
+					if (pStart < pEnd)
+						++pStart;
+				}
+				chunkStarts[chunkIndex] = pStart;
 			}
 
-			//Fix the tangents per vertex now because we accumulated
-			for (auto& v : vertices)
+			std::vector<ObjChunk> chunks(nrChunks);
+			const auto parseChunk = [&](uint32_t chunkIndex)
 			{
-				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+				ParseObjChunk(chunkStarts[chunkIndex], chunkStarts[chunkIndex + 1], chunks[chunkIndex]);
+			};
+
+			if (pThreadPool)
+				pThreadPool->ParallelFor(uint32_t(nrChunks), parseChunk);
+			else
+				for (uint32_t chunkIndex = 0; chunkIndex < nrChunks; ++chunkIndex)
+					parseChunk(chunkIndex);
+
+			//Faces use indices into the whole file, so they resolve no matter which chunk defined what they point at
+			//The corners stay in their chunks, the pass below reads them from there in file order
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> normals{};
+			std::vector<Vector2> UVs{};
+			StitchObjChunks(chunks, &ObjChunk::positions, positions, pThreadPool);
+			StitchObjChunks(chunks, &ObjChunk::normals, normals, pThreadPool);
+			StitchObjChunks(chunks, &ObjChunk::UVs, UVs, pThreadPool);
+
+			//Every chunk holds whole faces
+			size_t nrCorners{ 0 };
+			for (const ObjChunk& chunk : chunks)
+				nrCorners += chunk.corners.size();
+
+			//Corners that share a vertex share its position, so the position index works as a perfect hash:
+			//every position keeps a chain of the (usually one or two) vertices made from it
+			//One pass over the corners in file order numbers the vertices the same as a single threaded parse,
+			//and sums in the tangent of every face once its last corner is in
+			std::vector<uint32_t> firstVertexOfPosition(positions.size() + 1, UINT32_MAX);
+			std::vector<uint32_t> nextVertexOfPosition{};
+			std::vector<ObjCorner> vertexCorners{};
+			std::vector<Vector3> tangents{};
+
+			//Every position a face uses makes at least one vertex, most make one or two
+			nextVertexOfPosition.reserve(positions.size() * 2);
+			vertexCorners.reserve(positions.size() * 2);
+			tangents.reserve(positions.size() * 2);
+
+			const auto getUV = [&](const ObjCorner& corner) { return corner.iTexCoord > 0 ? UVs[corner.iTexCoord - 1] : Vector2{}; };
+
+			indices.resize(nrCorners);
+			size_t cornerIndex{ 0 };
+			for (const ObjChunk& chunk : chunks)
+			{
+				const ObjCorner* const pCorners{ chunk.corners.data() };
+				for (size_t chunkCorner = 0; chunkCorner < chunk.corners.size(); ++chunkCorner, ++cornerIndex)
+				{
+					const ObjCorner& corner{ pCorners[chunkCorner] };
+					if (corner.iPosition == 0 || corner.iPosition > positions.size() || corner.iTexCoord > UVs.size() || corner.iNormal > normals.size())
+						return false;
+
+					uint32_t vertexIndex{ firstVertexOfPosition[corner.iPosition] };
+					while (vertexIndex != UINT32_MAX && !(vertexCorners[vertexIndex] == corner))
+						vertexIndex = nextVertexOfPosition[vertexIndex];
 
-				if(flipAxisAndWinding)
+					if (vertexIndex == UINT32_MAX)
+					{
+						vertexIndex = uint32_t(vertexCorners.size());
+						nextVertexOfPosition.push_back(firstVertexOfPosition[corner.iPosition]);
+						firstVertexOfPosition[corner.iPosition] = vertexIndex;
+						vertexCorners.push_back(corner);
+						tangents.emplace_back();
+					}
+
+					//Swapping the last two corners of every triangle flips the winding
+					const size_t iFace{ cornerIndex % 3 };
+					const size_t target{ flipAxisAndWinding && iFace > 0 ? cornerIndex - iFace + 3 - iFace : cornerIndex };
+					indices[target] = vertexIndex;
+					if (iFace < 2)
+						continue;
+
+					//Cheap Tangent Calculations, a shared vertex sums the tangents of all its triangles
+					//Straight from the attribute arrays, in index order on one thread, so the sums round the same with or without a thread pool
+					const ObjCorner& corner0 = pCorners[chunkCorner - 2];
+					const ObjCorner& corner1 = flipAxisAndWinding ? corner : pCorners[chunkCorner - 1];
+					const ObjCorner& corner2 = flipAxisAndWinding ? pCorners[chunkCorner - 1] : corner;
+
+					const Vector3& p0 = positions[corner0.iPosition - 1];
+					const Vector3& p1 = positions[corner1.iPosition - 1];
+					const Vector3& p2 = positions[corner2.iPosition - 1];
+					const Vector2 uv0 = getUV(corner0);
+					const Vector2 uv1 = getUV(corner1);
+					const Vector2 uv2 = getUV(corner2);
+
+					const Vector3 edge0 = p1 - p0;
+					const Vector3 edge1 = p2 - p0;
+					const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
+					const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
+					const float uvArea = Vector2::Cross(diffX, diffY);
+
+					//Triangles without uv area have no tangent, don't let them spoil the neighbours they share vertices with
+					if (uvArea == 0.f)
+						continue;
+
+					float r = 1.f / uvArea;
+
+					Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
+					const size_t face{ cornerIndex - 2 };
+					tangents[indices[face]] += tangent;
+					tangents[indices[face + 1]] += tangent;
+					tangents[indices[face + 2]] += tangent;
+				}
+			}
+
+			const auto buildVertex = [&](size_t vertexIndex)
+			{
+				const ObjCorner& corner = vertexCorners[vertexIndex];
+				Vertex v{};
+				v.position = positions[corner.iPosition - 1];
+				if (corner.iTexCoord > 0)
+					v.uv = UVs[corner.iTexCoord - 1];
+				if (corner.iNormal > 0)
+					v.normal = normals[corner.iNormal - 1];
+
+				//Fix the tangents per vertex now because we accumulated
+				v.tangent = Vector3::Reject(tangents[vertexIndex], v.normal).Normalized();
+
+				//Vertices of only uv-degenerate triangles have no tangent, any one orthogonal to the normal keeps their lighting defined
+				if (!std::isfinite(v.tangent.x) || !std::isfinite(v.tangent.y) || !std::isfinite(v.tangent.z))
+					v.tangent = GetOrthogonalTangent(v.normal);
+
+				if (flipAxisAndWinding)
 				{
 					v.position.z *= -1.f;
 					v.normal.z *= -1.f;
 					v.tangent.z *= -1.f;
 				}
+				return v;
+			};
 
+			//The vertices only get built once their number is known, growing them one by one would keep copying the whole array
+			//On one thread they get appended to the reserved array, which writes every vertex once instead of default constructing it first
+			if (!pThreadPool)
+			{
+				vertices.reserve(vertexCorners.size());
+				for (size_t vertexIndex = 0; vertexIndex < vertexCorners.size(); ++vertexIndex)
+					vertices.push_back(buildVertex(vertexIndex));
+				return true;
 			}
 
+			vertices.resize(vertexCorners.size());
+			ForEachObjRange(vertices.size(), pThreadPool, [&](size_t begin, size_t end)
+				{
+					for (size_t vertexIndex = begin; vertexIndex < end; ++vertexIndex)
+						vertices[vertexIndex] = buildVertex(vertexIndex);
+				});
+
 			return true;
 #endif
 		}
+
+		//Adapter from the Vertex structs to the position streams the transform reads, call again after changing the vertices
+		static void BuildVertexStreams(const std::vector<Vertex>& vertices, VertexStreams& streams)
+		{
+			streams.positionX.resize(vertices.size());
+			streams.positionY.resize(vertices.size());
+			streams.positionZ.resize(vertices.size());
+
+			for (size_t i{ 0 }; i < vertices.size(); ++i)
+			{
+				streams.positionX[i] = vertices[i].position.x;
+				streams.positionY[i] = vertices[i].position.y;
+				streams.positionZ[i] = vertices[i].position.z;
+			}
+		}
 #pragma warning(pop)
 
 
-		bool IsInTriangel(const Vector2& screenspacePoint, const Vector2& v0, const Vector2& v1, const Vector2& v2)
+		inline bool IsInTriangel(const Vector2& screenspacePoint, const Vector2& v0, const Vector2& v1, const Vector2& v2)
 		{
 			Vector2 edgeA{ v1 - v0 };
 			if (Vector2::Cross(edgeA, screenspacePoint - v0) < 0)
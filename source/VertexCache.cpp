@@ -0,0 +1,39 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace dae;
+
+VertexCache::VertexCache()
+{
+	Clear();
+}
+
+void VertexCache::Clear()
+{
+	//No mesh gets anywhere near 4 billion vertices, so this never matches
+	std::fill(std::begin(m_Indices), std::end(m_Indices), UINT32_MAX);
+	m_OldestEntry = 0;
+}
+
+bool VertexCache::Lookup(uint32_t index)
+{
+	++m_NrLookups;
+	if (std::find(std::begin(m_Indices), std::end(m_Indices), index) != std::end(m_Indices))
+	{
+		++m_NrHits;
+		return true;
+	}
+
+	//FIFO: a hit doesn't refresh an entry, the oldest miss always gets replaced
+	m_Indices[m_OldestEntry] = index;
+	m_OldestEntry = (m_OldestEntry + 1) % m_Size;
+	return false;
+}
+
+void VertexCache::ResetStats()
+{
+	m_NrLookups = 0;
+	m_NrHits = 0;
+}
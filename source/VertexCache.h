@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//FIFO post-transform cache like the one GPUs keep between the vertex shader and triangle setup
+	//Only keeps track of which indices are in it, the transformed vertices themselves stay in their slot of the vertex outputs
+	class VertexCache final
+	{
+	public:
+		static constexpr int m_Size{ 32 };
+
+		VertexCache();
+
+		//Empties the cache, the hit counts keep going
+		void Clear();
+		//Returns true on a hit, on a miss the index replaces the oldest entry and has to be transformed (again)
+		bool Lookup(uint32_t index);
+
+		void ResetStats();
+		uint32_t GetNrLookups() const { return m_NrLookups; }
+		uint32_t GetNrHits() const { return m_NrHits; }
+
+	private:
+		uint32_t m_Indices[m_Size]{};
+		int m_OldestEntry{};
+
+		uint32_t m_NrLookups{};
+		uint32_t m_NrHits{};
+	};
+}
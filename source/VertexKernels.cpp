@@ -0,0 +1,224 @@
+#include "VertexKernels.h"
+
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace VertexKernels
+	{
+		namespace
+		{
+			//bit in the lanes where isOutside is set, 0 in the others
+			DAE_TARGET_AVX2 __m256i ClipBit(__m256 isOutside, uint16_t bit)
+			{
+				return _mm256_and_si256(_mm256_castps_si256(isOutside), _mm256_set1_epi32(bit));
+			}
+
+			//The matrix and constants every batch of 8 vertices needs, set up once per call
+			struct TransformConstants
+			{
+				__m256 matrix[4][4]{};
+				__m256 zero{};
+				__m256 one{};
+				__m256 half{};
+				__m256 guardBand{};
+				__m256 width{};
+				__m256 height{};
+			};
+
+			//Outputs of 8 vertices, one lane each, clip codes still 32 bit
+			struct TransformedBatch
+			{
+				__m256i clipCodes{};
+				__m256 screenX{};
+				__m256 screenY{};
+				__m256 depth{};
+				__m256 invW{};
+			};
+
+			DAE_TARGET_AVX2 TransformConstants GetTransformConstants(const Matrix& worldViewProjection, const TransformTarget& target)
+			{
+				TransformConstants constants{};
+				for (int row{ 0 }; row < 4; ++row)
+				{
+					const Vector4 matrixRow{ worldViewProjection[row] };
+					for (int column{ 0 }; column < 4; ++column)
+					{
+						constants.matrix[row][column] = _mm256_set1_ps(matrixRow[column]);
+					}
+				}
+
+				constants.zero = _mm256_setzero_ps();
+				constants.one = _mm256_set1_ps(1.f);
+				constants.half = _mm256_set1_ps(0.5f);
+				constants.guardBand = _mm256_set1_ps(GuardBand);
+				constants.width = _mm256_set1_ps(target.width);
+				constants.height = _mm256_set1_ps(target.height);
+				return constants;
+			}
+
+			DAE_TARGET_AVX2 TransformedBatch TransformBatch(const TransformConstants& constants, __m256 x, __m256 y, __m256 z)
+			{
+				// Same order as Matrix::TransformPoint: ((m0 * x + m1 * y) + m2 * z) + m3
+				__m256 clip[4]{};
+				for (int column{ 0 }; column < 4; ++column)
+				{
+					clip[column] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(constants.matrix[0][column], x), _mm256_mul_ps(constants.matrix[1][column], y)), _mm256_mul_ps(constants.matrix[2][column], z)), constants.matrix[3][column]);
+				}
+
+				const __m256 negativeW{ _mm256_sub_ps(constants.zero, clip[3]) };
+				const __m256 guardW{ _mm256_mul_ps(constants.guardBand, clip[3]) };
+				const __m256 negativeGuardW{ _mm256_sub_ps(constants.zero, guardW) };
+
+				TransformedBatch batch{};
+				batch.clipCodes = ClipBit(_mm256_cmp_ps(clip[0], negativeW, _CMP_LT_OQ), Left);
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[0], clip[3], _CMP_GT_OQ), Right));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[1], negativeW, _CMP_LT_OQ), Bottom));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[1], clip[3], _CMP_GT_OQ), Top));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[2], constants.zero, _CMP_LT_OQ), Near));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[2], clip[3], _CMP_GT_OQ), Far));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[0], negativeGuardW, _CMP_LT_OQ), GuardLeft));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[0], guardW, _CMP_GT_OQ), GuardRight));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[1], negativeGuardW, _CMP_LT_OQ), GuardBottom));
+				batch.clipCodes = _mm256_or_si256(batch.clipCodes, ClipBit(_mm256_cmp_ps(clip[1], guardW, _CMP_GT_OQ), GuardTop));
+
+				batch.invW = _mm256_div_ps(constants.one, clip[3]);
+				const __m256 ndcX{ _mm256_mul_ps(clip[0], batch.invW) };
+				const __m256 ndcY{ _mm256_mul_ps(clip[1], batch.invW) };
+				batch.depth = _mm256_mul_ps(clip[2], batch.invW);
+
+				// Halving is exact, so multiplying by 0.5 matches the scalar divide by 2
+				batch.screenX = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(ndcX, constants.one), constants.half), constants.width);
+				batch.screenY = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(constants.one, ndcY), constants.half), constants.height);
+				return batch;
+			}
+		}
+
+		TransformKernel GetTransformKernel(RasterKernels::InstructionSet instructionSet)
+		{
+			//SSE4.1 machines take the scalar loop, 4 wide doesn't win enough over what the compiler already does
+			if (instructionSet == RasterKernels::InstructionSet::AVX2)
+			{
+				return &TransformPositionsAVX2;
+			}
+			return &TransformPositions;
+		}
+
+		IndexedTransformKernel GetIndexedTransformKernel(RasterKernels::InstructionSet instructionSet)
+		{
+			//Same split as GetTransformKernel
+			if (instructionSet == RasterKernels::InstructionSet::AVX2)
+			{
+				return &TransformIndexedPositionsAVX2;
+			}
+			return &TransformIndexedPositions;
+		}
+
+		uint16_t ComputeClipCode(const Vector4& clipPosition)
+		{
+			const float guardW{ GuardBand * clipPosition.w };
+
+			uint16_t clipCode{ 0 };
+			clipCode |= clipPosition.x < -clipPosition.w ? Left : 0;
+			clipCode |= clipPosition.x > clipPosition.w ? Right : 0;
+			clipCode |= clipPosition.y < -clipPosition.w ? Bottom : 0;
+			clipCode |= clipPosition.y > clipPosition.w ? Top : 0;
+			clipCode |= clipPosition.z < 0.f ? Near : 0;
+			clipCode |= clipPosition.z > clipPosition.w ? Far : 0;
+			clipCode |= clipPosition.x < -guardW ? GuardLeft : 0;
+			clipCode |= clipPosition.x > guardW ? GuardRight : 0;
+			clipCode |= clipPosition.y < -guardW ? GuardBottom : 0;
+			clipCode |= clipPosition.y > guardW ? GuardTop : 0;
+			return clipCode;
+		}
+
+		void TransformPositions(const Matrix& worldViewProjection, const VertexStreams& streams, size_t first, size_t count, const TransformTarget& target)
+		{
+			for (size_t i{ first }; i < first + count; ++i)
+			{
+				const Vector4 clipPosition{ worldViewProjection.TransformPoint(streams.positionX[i], streams.positionY[i], streams.positionZ[i], 1.f) };
+				target.pClipCodes[i] = ComputeClipCode(clipPosition);
+
+				// Vertices behind the near plane end up with meaningless NDC, only clipped triangles ever use them
+				const float invVw{ 1 / clipPosition.w };
+				const float ndcX{ clipPosition.x * invVw };
+				const float ndcY{ clipPosition.y * invVw };
+
+				// NDC --> Screenspace
+				target.pScreenPositions[i] = { (ndcX + 1) / 2.0f * target.width, (1.0f - ndcY) / 2.0f * target.height };
+				target.pDepths[i] = clipPosition.z * invVw;
+				target.pInvW[i] = invVw;
+			}
+		}
+
+		DAE_TARGET_AVX2 void TransformPositionsAVX2(const Matrix& worldViewProjection, const VertexStreams& streams, size_t first, size_t count, const TransformTarget& target)
+		{
+			const TransformConstants constants{ GetTransformConstants(worldViewProjection, target) };
+
+			const size_t end{ first + count };
+			size_t i{ first };
+			for (; i + 8 <= end; i += 8)
+			{
+				const TransformedBatch batch{ TransformBatch(constants, _mm256_loadu_ps(streams.positionX.data() + i), _mm256_loadu_ps(streams.positionY.data() + i), _mm256_loadu_ps(streams.positionZ.data() + i)) };
+
+				// Pack to 16 bit, packus works per 128 bit lane so the two halves get joined after
+				const __m256i packedCodes{ _mm256_permute4x64_epi64(_mm256_packus_epi32(batch.clipCodes, batch.clipCodes), 0b1000) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target.pClipCodes + i), _mm256_castsi256_si128(packedCodes));
+
+				_mm256_storeu_ps(target.pDepths + i, batch.depth);
+				_mm256_storeu_ps(target.pInvW + i, batch.invW);
+
+				// Interleave to x0 y0 x1 y1 ..., unpack works per 128 bit lane so the halves get swapped back in place after
+				const __m256 low{ _mm256_unpacklo_ps(batch.screenX, batch.screenY) };
+				const __m256 high{ _mm256_unpackhi_ps(batch.screenX, batch.screenY) };
+				float* pScreen{ &target.pScreenPositions[i].x };
+				_mm256_storeu_ps(pScreen, _mm256_permute2f128_ps(low, high, 0x20));
+				_mm256_storeu_ps(pScreen + 8, _mm256_permute2f128_ps(low, high, 0x31));
+			}
+
+			TransformPositions(worldViewProjection, streams, i, end - i, target);
+		}
+
+		void TransformIndexedPositions(const Matrix& worldViewProjection, const VertexStreams& streams, const uint32_t* pIndices, size_t count, const TransformTarget& target)
+		{
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				TransformPositions(worldViewProjection, streams, pIndices[i], 1, target);
+			}
+		}
+
+		DAE_TARGET_AVX2 void TransformIndexedPositionsAVX2(const Matrix& worldViewProjection, const VertexStreams& streams, const uint32_t* pIndices, size_t count, const TransformTarget& target)
+		{
+			const TransformConstants constants{ GetTransformConstants(worldViewProjection, target) };
+
+			size_t i{ 0 };
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256i indices{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pIndices + i)) };
+				const TransformedBatch batch{ TransformBatch(constants, _mm256_i32gather_ps(streams.positionX.data(), indices, 4), _mm256_i32gather_ps(streams.positionY.data(), indices, 4), _mm256_i32gather_ps(streams.positionZ.data(), indices, 4)) };
+
+				// AVX2 has no scatter, every lane goes to the slot of its vertex on its own
+				alignas(32) uint32_t clipCodes[8];
+				alignas(32) float screenX[8];
+				alignas(32) float screenY[8];
+				alignas(32) float depths[8];
+				alignas(32) float invW[8];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(clipCodes), batch.clipCodes);
+				_mm256_store_ps(screenX, batch.screenX);
+				_mm256_store_ps(screenY, batch.screenY);
+				_mm256_store_ps(depths, batch.depth);
+				_mm256_store_ps(invW, batch.invW);
+				for (int lane{ 0 }; lane < 8; ++lane)
+				{
+					const uint32_t vertexIndex{ pIndices[i + lane] };
+					target.pClipCodes[vertexIndex] = static_cast<uint16_t>(clipCodes[lane]);
+					target.pScreenPositions[vertexIndex] = { screenX[lane], screenY[lane] };
+					target.pDepths[vertexIndex] = depths[lane];
+					target.pInvW[vertexIndex] = invW[lane];
+				}
+			}
+
+			TransformIndexedPositions(worldViewProjection, streams, pIndices + i, count - i, target);
+		}
+	}
+}
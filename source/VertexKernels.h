@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "DataTypes.h"
+#include "RasterKernels.h"
+
+namespace dae
+{
+	namespace VertexKernels
+	{
+		//Clip space outcodes, triangles inside the guard band are rasterized as is, only near plane and guard band crossers get clipped
+		enum ClipCode : uint16_t
+		{
+			Left		= 1 << 0,
+			Right		= 1 << 1,
+			Bottom		= 1 << 2,
+			Top			= 1 << 3,
+			Near		= 1 << 4,
+			Far			= 1 << 5,
+			GuardLeft	= 1 << 6,
+			GuardRight	= 1 << 7,
+			GuardBottom	= 1 << 8,
+			GuardTop	= 1 << 9,
+
+			Frustum		= Left | Right | Bottom | Top | Near | Far,
+			NeedsClip	= Near | GuardLeft | GuardRight | GuardBottom | GuardTop
+		};
+
+		//Guard band edges in NDC, far enough out that a triangle reaching them is rare and close enough to keep the edge functions precise
+		constexpr float GuardBand{ 8.f };
+
+		//Per vertex outputs of the position transform, element i belongs to vertex i
+		struct TransformTarget
+		{
+			Vector2* pScreenPositions{};
+			float* pDepths{};
+			float* pInvW{};
+			uint16_t* pClipCodes{};
+			float width{};
+			float height{};
+		};
+
+		//Transforms the positions of vertices [first, first + count) to clip space, stores their outcode, 1/w and after the perspective divide their screen position and depth
+		//Bit-identical on every instruction set, see RasterKernels::InstructionSet
+		using TransformKernel = void(*)(const Matrix& worldViewProjection, const VertexStreams& streams, size_t first, size_t count, const TransformTarget& target);
+
+		//Same for the vertices pIndices lists, in that order, the outputs still go to the slot of each vertex
+		//The on demand path hands it the vertices that missed the post-transform cache
+		using IndexedTransformKernel = void(*)(const Matrix& worldViewProjection, const VertexStreams& streams, const uint32_t* pIndices, size_t count, const TransformTarget& target);
+
+		TransformKernel GetTransformKernel(RasterKernels::InstructionSet instructionSet);
+		IndexedTransformKernel GetIndexedTransformKernel(RasterKernels::InstructionSet instructionSet);
+
+		uint16_t ComputeClipCode(const Vector4& clipPosition);
+
+		void TransformPositions(const Matrix& worldViewProjection, const VertexStreams& streams, size_t first, size_t count, const TransformTarget& target);
+		void TransformPositionsAVX2(const Matrix& worldViewProjection, const VertexStreams& streams, size_t first, size_t count, const TransformTarget& target);
+		void TransformIndexedPositions(const Matrix& worldViewProjection, const VertexStreams& streams, const uint32_t* pIndices, size_t count, const TransformTarget& target);
+		void TransformIndexedPositionsAVX2(const Matrix& worldViewProjection, const VertexStreams& streams, const uint32_t* pIndices, size_t count, const TransformTarget& target);
+	}
+}
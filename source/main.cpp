@@ -63,6 +63,16 @@ int main(int argc, char* args[])
 			case SDL_KEYUP:
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
+					pRenderer->CycleInstructionSet();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
+					pRenderer->ToggleVertexCache();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					pRenderer->CycleShadingMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->CycleTextureFilter();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+					pRenderer->ToggleDeferredShading();
 				break;
 			}
 		}
@@ -80,6 +90,21 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+
+			const CullStats& cullStats{ pRenderer->GetCullStats() };
+			std::cout << "Culled: frustum " << cullStats.outsideFrustum << ", facing " << cullStats.facing << ", zero area " << cullStats.zeroArea
+				<< ", no sample " << cullStats.noSample << ", off screen " << cullStats.offScreen << std::endl;
+
+			const FrameArena& frameArena{ pRenderer->GetFrameArena() };
+			std::cout << "Frame arena: " << frameArena.GetCapacity() / 1024 << " KB, " << frameArena.GetNrHeapAllocations() << " heap allocations" << std::endl;
+
+			const std::vector<VertexCacheStats>& vertexCacheStats{ pRenderer->GetVertexCacheStats() };
+			for (size_t meshIndex{ 0 }; meshIndex < vertexCacheStats.size(); ++meshIndex)
+			{
+				const VertexCacheStats& stats{ vertexCacheStats[meshIndex] };
+				const float hitRate{ stats.nrLookups > 0 ? 100.f * stats.nrHits / stats.nrLookups : 0.f };
+				std::cout << "Vertex cache mesh " << meshIndex << ": " << hitRate << "% hits (" << stats.nrHits << '/' << stats.nrLookups << ')' << std::endl;
+			}
 		}
 
 		//Save screenshot after full render